@@ -0,0 +1,449 @@
+// CompiledOSCPattern.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "LiteOSCParser.h"
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
+#else
+#include <cstring>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+// Marks the end of the chain of jumps out of a "{...}" while it's being
+// compiled.
+static constexpr uint8_t kNoJump = 0xff;
+
+// Clears the bits from 'from' up to, but not including, 'to'.
+static void clearBits(uint32_t *words, int from, int to) {
+  while (from < to) {
+    int n = 32 - (from & 31);
+    if (n > to - from) {
+      n = to - from;
+    }
+    uint32_t mask = (n == 32) ? ~uint32_t{0} : ((uint32_t{1} << n) - 1);
+    words[from >> 5] &= ~(mask << (from & 31));
+    from += n;
+  }
+}
+
+bool CompiledOSCPattern::isPattern(const char *s) {
+  return strpbrk(s, "?*[{") != nullptr;
+}
+
+bool CompiledOSCPattern::isSpecial(char c) {
+  return c == '?' || c == '*' || c == '[' || c == '{';
+}
+
+bool CompiledOSCPattern::emit(Op op, uint8_t a, uint8_t b) {
+  if (progLen_ >= kMaxInstructions) {
+    return false;
+  }
+  prog_[progLen_].op = op;
+  prog_[progLen_].a = a;
+  prog_[progLen_].b = b;
+  progLen_++;
+  return true;
+}
+
+bool CompiledOSCPattern::emitChar(char c, int *stringPc) {
+  if (charsLen_ >= kMaxLiteralChars) {
+    return false;
+  }
+  if (*stringPc < 0) {
+    *stringPc = progLen_;
+    if (!emit(kString, charsLen_, 0)) {
+      return false;
+    }
+  }
+  chars_[charsLen_++] = c;
+  prog_[*stringPc].b++;
+  return true;
+}
+
+bool CompiledOSCPattern::compile(const char *pattern, int len) {
+  progLen_ = 0;
+  charsLen_ = 0;
+  valid_ = false;
+  literal_ = true;
+  for (int i = 0; i < len; i++) {
+    if (isSpecial(pattern[i])) {
+      literal_ = false;
+      break;
+    }
+  }
+
+  // Consecutive literal characters share one kString; this is where the
+  // current one is, or -1 after anything else
+  int stringPc = -1;
+
+  const char *p = pattern;
+  const char *end = &pattern[len];
+  while (p < end) {
+    switch (*p) {
+      case '?':
+        if (!emit(kAny, 0, 0)) {
+          return false;
+        }
+        stringPc = -1;
+        p++;
+        break;
+
+      case '*': {
+        // Consecutive stars are the same as one
+        while (p < end && *p == '*') {
+          p++;
+        }
+        if (!emit(kStar, 0, 0)) {
+          return false;
+        }
+        stringPc = -1;
+        break;
+      }
+
+      case '[': {
+        p++;
+        bool negate = (p < end && *p == '!');
+        if (negate) {
+          p++;
+        }
+        int classPc = progLen_;
+        if (!emit(kClass, 0, negate)) {
+          return false;
+        }
+        int count = 0;
+        while (true) {
+          if (p >= end) {
+            return false;
+          }
+          if (*p == ']') {
+            break;
+          }
+          uint8_t lo = *p;
+          uint8_t hi = lo;
+          if (end - p > 2 && p[1] == '-' && p[2] != ']') {
+            hi = p[2];
+            p += 3;
+          } else {
+            p++;
+          }
+          if (lo > hi) {
+            uint8_t t = lo;
+            lo = hi;
+            hi = t;
+          }
+          if (!emit(kRange, lo, hi)) {
+            return false;
+          }
+          count++;
+        }
+        p++;
+        prog_[classPc].a = count;
+        stringPc = -1;
+        break;
+      }
+
+      case '{': {
+        p++;
+
+        // Each string starts with a split to it and to the next string.
+        // The jumps out of each string are chained through their targets
+        // and then patched once the end is known.
+        uint8_t jumps = kNoJump;
+        while (true) {
+          int splitPc = progLen_;
+          if (!emit(kSplit, splitPc + 1, 0)) {
+            return false;
+          }
+          stringPc = -1;
+          while (true) {
+            if (p >= end) {
+              return false;
+            }
+            if (*p == ',' || *p == '}') {
+              break;
+            }
+            if (!emitChar(*p, &stringPc)) {
+              return false;
+            }
+            p++;
+          }
+          if (*p == '}') {
+            // The last string has nowhere else to go
+            prog_[splitPc].b = splitPc + 1;
+            p++;
+            break;
+          }
+          int jumpPc = progLen_;
+          if (!emit(kJump, jumps, 0)) {
+            return false;
+          }
+          jumps = jumpPc;
+          prog_[splitPc].b = progLen_;
+          p++;
+        }
+        while (jumps != kNoJump) {
+          uint8_t next = prog_[jumps].a;
+          prog_[jumps].a = progLen_;
+          jumps = next;
+        }
+
+        // Nothing may be added to the last string, because the others
+        // jump past it
+        stringPc = -1;
+        break;
+      }
+
+      default:
+        if (!emitChar(*p, &stringPc)) {
+          return false;
+        }
+        p++;
+    }
+  }
+
+  if (!emit(kMatch, 0, 0)) {
+    return false;
+  }
+  valid_ = true;
+  return true;
+}
+
+bool CompiledOSCPattern::accepts(int pc, uint8_t c) const {
+  const Instruction &inst = prog_[pc];
+  switch (inst.op) {
+    case kAny:
+    case kStar:
+      return c != '/';
+    case kClass: {
+      if (c == '/') {
+        return false;
+      }
+      bool in = false;
+      for (int i = 1; i <= inst.a; i++) {
+        if (prog_[pc + i].a <= c && c <= prog_[pc + i].b) {
+          in = true;
+          break;
+        }
+      }
+      return in != (inst.b != 0);
+    }
+    default:
+      return false;
+  }
+}
+
+int CompiledOSCPattern::nextPc(int pc) const {
+  switch (prog_[pc].op) {
+    case kClass:
+      return pc + 1 + prog_[pc].a;
+    case kStar:
+      return pc;
+    default:
+      return pc + 1;
+  }
+}
+
+void CompiledOSCPattern::addThread(StateSet *set, int pc, int off,
+                                   uint8_t *stack) const {
+  // Only the first state can be partway through a kString
+  if (off > 0) {
+    const Instruction &inst = prog_[pc];
+    uint32_t runBit = uint32_t{1} << (pc & 31);
+    if ((set->runs[pc >> 5] & runBit) == 0) {
+      set->runs[pc >> 5] |= runBit;
+      clearBits(set->chars, inst.a + 1, inst.a + inst.b);
+    }
+    int pos = inst.a + off;
+    uint32_t bit = uint32_t{1} << (pos & 31);
+    if ((set->chars[pos >> 5] & bit) == 0) {
+      set->chars[pos >> 5] |= bit;
+      set->record(pc, off);
+    }
+    return;
+  }
+
+  // Only a split needs to remember where else to go, and each split is
+  // seen at most once, so the stack never needs more than
+  // kMaxInstructions entries
+  int top = 0;
+  while (true) {
+    uint32_t bit = uint32_t{1} << (pc & 31);
+    if ((set->seen[pc >> 5] & bit) == 0) {
+      set->seen[pc >> 5] |= bit;
+      const Instruction &inst = prog_[pc];
+      switch (inst.op) {
+        case kSplit:
+          stack[top++] = inst.b;
+          pc = inst.a;
+          continue;
+        case kJump:
+          pc = inst.a;
+          continue;
+        case kStar:
+          // A star can also match nothing
+          set->pcs[set->pcCount++] = pc;
+          set->record(pc, 0);
+          pc++;
+          continue;
+        default:
+          set->pcs[set->pcCount++] = pc;
+          set->record(pc, 0);
+      }
+    }
+    if (top == 0) {
+      break;
+    }
+    pc = stack[--top];
+  }
+}
+
+bool CompiledOSCPattern::matches(const char *address, int len) const {
+  if (!valid_) {
+    return false;
+  }
+
+  // A literal pattern is its characters followed by kMatch
+  if (literal_) {
+    return len == charsLen_ && memcmp(chars_, address, len) == 0;
+  }
+
+  // Follow every state that could be current at the same time, so that
+  // each address character is looked at only once
+  StateSet sets[2];
+  uint8_t stack[kMaxInstructions];
+  StateSet *cur = &sets[0];
+  StateSet *next = &sets[1];
+  cur->clear();
+  addThread(cur, 0, 0, stack);
+
+  int i = 0;
+  while (i < len) {
+    // With only one state, there's nothing to choose between until the
+    // next star, "{...}", or the end, and literal runs can be compared
+    // all at once
+    if (cur->count == 1) {
+      int pc = cur->first[0];
+      int off = cur->firstOff[0];
+      if (prog_[pc].op == kMatch) {
+        return false;
+      }
+      do {
+        const Instruction &inst = prog_[pc];
+        if (inst.op == kString) {
+          int n = inst.b - off;
+          if (n > len - i) {
+            n = len - i;
+          }
+          const char *run = &chars_[inst.a + off];
+          for (int k = 0; k < n; k++) {
+            if (run[k] != address[i + k]) {
+              return false;
+            }
+          }
+          i += n;
+          off += n;
+          if (off < inst.b) {
+            break;  // The address ended partway through
+          }
+          pc++;
+          off = 0;
+        } else {
+          if (!accepts(pc, address[i])) {
+            return false;
+          }
+          pc = nextPc(pc);
+          i++;
+        }
+      } while (i < len && prog_[pc].op <= kClass);
+      cur->clear();
+      addThread(cur, pc, off, stack);
+      continue;
+    }
+
+    // A star followed by a literal, or by the end, stays in the same
+    // state until the literal's first character or a '/' is seen
+    if (cur->count == 2 && prog_[cur->first[0]].op == kStar &&
+        cur->first[1] == cur->first[0] + 1 && cur->firstOff[1] == 0) {
+      const Instruction &inst = prog_[cur->first[1]];
+      if (inst.op == kString) {
+        while (i < len && address[i] != chars_[inst.a] && address[i] != '/') {
+          i++;
+        }
+        if (i >= len) {
+          break;
+        }
+      } else if (inst.op == kMatch) {
+        return memchr(&address[i], '/', len - i) == nullptr;
+      }
+    }
+
+    uint8_t c = address[i++];
+    next->clear();
+    for (int t = 0; t < cur->pcCount; t++) {
+      int pc = cur->pcs[t];
+      const Instruction &inst = prog_[pc];
+      if (inst.op == kString) {
+        if (static_cast<uint8_t>(chars_[inst.a]) == c) {
+          advance(next, pc, 0, stack);
+        }
+      } else if (accepts(pc, c)) {
+        addThread(next, nextPc(pc), 0, stack);
+      }
+    }
+
+    // Step the positions partway through each kString
+    for (int pc = 0; pc < progLen_; pc++) {
+      uint32_t bits = cur->runs[pc >> 5] >> (pc & 31);
+      if (bits == 0) {
+        pc |= 31;
+        continue;
+      }
+      if ((bits & 1) == 0) {
+        continue;
+      }
+      const Instruction &inst = prog_[pc];
+      int pos = inst.a + 1;
+      int end = inst.a + inst.b;
+      while (pos < end) {
+        bits = cur->chars[pos >> 5] >> (pos & 31);
+        if (end - pos < 32) {
+          bits &= (uint32_t{1} << (end - pos)) - 1;
+        }
+        if (bits == 0) {
+          pos = (pos | 31) + 1;
+          continue;
+        }
+        while ((bits & 1) == 0) {
+          bits >>= 1;
+          pos++;
+        }
+        if (static_cast<uint8_t>(chars_[pos]) == c) {
+          advance(next, pc, pos - inst.a, stack);
+        }
+        pos++;
+      }
+    }
+
+    if (next->count == 0) {
+      return false;
+    }
+    StateSet *t = cur;
+    cur = next;
+    next = t;
+  }
+
+  // kMatch is always the last instruction
+  int pc = progLen_ - 1;
+  return (cur->seen[pc >> 5] & (uint32_t{1} << (pc & 31))) != 0;
+}
+
+}  // namespace osc
+}  // namespace qindesign
@@ -5,6 +5,11 @@
 
 // C++ includes
 #ifdef __has_include
+#if __has_include(<climits>)
+#include <climits>
+#else
+#include <limits.h>
+#endif
 #if __has_include(<cstdlib>)
 #include <cstdlib>
 #else
@@ -16,51 +21,252 @@
 #include <string.h>
 #endif
 #else
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 #endif
 
+// Vector includes, for scanning strings
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 namespace qindesign {
 namespace osc {
 
-LiteOSCParser::LiteOSCParser(int bufCapacity, int maxArgCount)
+// Swaps two values. This avoids needing <utility>, which isn't available
+// everywhere.
+template <typename T>
+static void swapValues(T &a, T &b) {
+  T t = a;
+  a = b;
+  b = t;
+}
+
+// Builds the tag table from describeTag at compile time.
+#define DESCRIBE_TAGS_4(n)                                  \
+  describeTag(n), describeTag((n) + 1), describeTag((n) + 2), \
+      describeTag((n) + 3)
+#define DESCRIBE_TAGS_16(n)                        \
+  DESCRIBE_TAGS_4(n), DESCRIBE_TAGS_4((n) + 4),    \
+      DESCRIBE_TAGS_4((n) + 8), DESCRIBE_TAGS_4((n) + 12)
+#define DESCRIBE_TAGS_64(n)                         \
+  DESCRIBE_TAGS_16(n), DESCRIBE_TAGS_16((n) + 16),  \
+      DESCRIBE_TAGS_16((n) + 32), DESCRIBE_TAGS_16((n) + 48)
+
+#if defined(__AVR__)
+const uint8_t OSCMessageView::kTagTable[256] PROGMEM{
+#else
+const uint8_t OSCMessageView::kTagTable[256]{
+#endif
+    DESCRIBE_TAGS_64(0),
+    DESCRIBE_TAGS_64(64),
+    DESCRIBE_TAGS_64(128),
+    DESCRIBE_TAGS_64(192),
+};
+
+#undef DESCRIBE_TAGS_64
+#undef DESCRIBE_TAGS_16
+#undef DESCRIBE_TAGS_4
+
+OSCMessageView::OSCMessageView(int maxArgCount, OSCAllocator *allocator)
     : buf_(nullptr),
       bufSize_(0),
-      bufCapacity_(0),
-      dynamicBuf_(true),
       memoryErr_(false),
       addressLen_(0),
       tagsLen_(0),
       argIndexes_(nullptr),
       argIndexesCapacity_(0),
-      dynamicArgIndexes_(true) {
+      dynamicArgIndexes_(true),
+      lazyArgs_(false),
+      argsResolved_(0),
+      argsEnd_(0),
+      segmentCount_(0),
+      hashAddress_(false),
+      addressHash_(0),
+      addressHashValid_(false),
+      allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      reallocCount_(0) {
+  if (maxArgCount > 0) {
+    dynamicArgIndexes_ = false;
+    argIndexes_ = static_cast<int *>(
+        allocator_->allocate(maxArgCount * sizeof(int)));
+    if (argIndexes_ == nullptr) {
+      memoryErr_ = true;
+    } else {
+      argIndexesCapacity_ = maxArgCount;
+    }
+  }
+}
+
+OSCMessageView::OSCMessageView(OSCMessageView &&other) noexcept
+    : OSCMessageView(0, other.allocator_) {
+  swap(other);
+}
+
+OSCMessageView &OSCMessageView::operator=(OSCMessageView &&other) noexcept {
+  if (this != &other) {
+    release();
+    swap(other);
+  }
+  return *this;
+}
+
+OSCMessageView::~OSCMessageView() {
+  if (argIndexes_ != nullptr) {
+    allocator_->deallocate(argIndexes_, argIndexesCapacity_ * sizeof(int));
+  }
+}
+
+void OSCMessageView::swap(OSCMessageView &other) noexcept {
+  swapValues(buf_, other.buf_);
+  swapValues(bufSize_, other.bufSize_);
+  swapValues(memoryErr_, other.memoryErr_);
+  swapValues(addressLen_, other.addressLen_);
+  swapValues(tagsIndex_, other.tagsIndex_);
+  swapValues(tagsLen_, other.tagsLen_);
+  swapValues(dataIndex_, other.dataIndex_);
+  swapValues(argIndexes_, other.argIndexes_);
+  swapValues(argIndexesCapacity_, other.argIndexesCapacity_);
+  swapValues(dynamicArgIndexes_, other.dynamicArgIndexes_);
+  swapValues(lazyArgs_, other.lazyArgs_);
+  swapValues(argsResolved_, other.argsResolved_);
+  swapValues(argsEnd_, other.argsEnd_);
+  swapValues(segmentCount_, other.segmentCount_);
+  for (int i = 0; i < kMaxSegments; i++) {
+    swapValues(segments_[i], other.segments_[i]);
+  }
+  swapValues(hashAddress_, other.hashAddress_);
+  swapValues(addressHash_, other.addressHash_);
+  swapValues(addressHashValid_, other.addressHashValid_);
+  swapValues(allocator_, other.allocator_);
+  swapValues(reallocCount_, other.reallocCount_);
+}
+
+void OSCMessageView::release() {
+  if (argIndexes_ != nullptr) {
+    allocator_->deallocate(argIndexes_, argIndexesCapacity_ * sizeof(int));
+  }
+  buf_ = nullptr;
+  bufSize_ = 0;
+  memoryErr_ = false;
+  addressLen_ = 0;
+  tagsIndex_ = 0;
+  tagsLen_ = 0;
+  dataIndex_ = 0;
+  argIndexes_ = nullptr;
+  argIndexesCapacity_ = 0;
+  dynamicArgIndexes_ = true;
+  lazyArgs_ = false;
+  argsResolved_ = 0;
+  argsEnd_ = 0;
+  segmentCount_ = 0;
+  hashAddress_ = false;
+  addressHashValid_ = false;
+  reallocCount_ = 0;
+}
+
+LiteOSCParser::LiteOSCParser(int bufCapacity, int maxArgCount,
+                             OSCAllocator *allocator)
+    : OSCMessageView(maxArgCount, allocator),
+      ownBuf_(nullptr),
+      bufCapacity_(0),
+      dynamicBuf_(true),
+      declaredTagsLen_(0) {
   static_assert(sizeof(uint8_t) == 1, "sizeof(uint8_t) == 1");
   if (bufCapacity > 0) {
     dynamicBuf_ = false;
-    buf_ = static_cast<uint8_t *>(malloc(bufCapacity));
-    if (buf_ == nullptr) {
+    ownBuf_ = static_cast<uint8_t *>(allocator_->allocate(bufCapacity));
+    if (ownBuf_ == nullptr) {
       memoryErr_ = true;
     } else {
       bufCapacity_ = bufCapacity;
     }
   }
-  if (maxArgCount > 0) {
-    dynamicArgIndexes_ = false;
-    argIndexes_ = static_cast<int *>(malloc(maxArgCount * sizeof(int)));
-    if (argIndexes_ == nullptr) {
-      memoryErr_ = true;
-    } else {
-      argIndexesCapacity_ = maxArgCount;
-    }
+  buf_ = ownBuf_;
+}
+
+LiteOSCParser::LiteOSCParser(LiteOSCParser &&other) noexcept
+    : LiteOSCParser(0, 0, other.allocator_) {
+  swap(other);
+}
+
+LiteOSCParser &LiteOSCParser::operator=(LiteOSCParser &&other) noexcept {
+  if (this != &other) {
+    releaseBuf();
+    release();
+    swap(other);
   }
+  return *this;
 }
 
 LiteOSCParser::~LiteOSCParser() {
-  if (buf_ != nullptr) {
-    free(buf_);
+  if (ownBuf_ != nullptr) {
+    allocator_->deallocate(ownBuf_, bufCapacity_);
   }
-  if (argIndexes_ != nullptr) {
-    free(argIndexes_);
+}
+
+void LiteOSCParser::swap(LiteOSCParser &other) noexcept {
+  OSCMessageView::swap(other);
+  swapValues(ownBuf_, other.ownBuf_);
+  swapValues(bufCapacity_, other.bufCapacity_);
+  swapValues(dynamicBuf_, other.dynamicBuf_);
+  swapValues(declaredTagsLen_, other.declaredTagsLen_);
+}
+
+void LiteOSCParser::releaseBuf() {
+  if (ownBuf_ != nullptr) {
+    allocator_->deallocate(ownBuf_, bufCapacity_);
+  }
+  ownBuf_ = nullptr;
+  bufCapacity_ = 0;
+  dynamicBuf_ = true;
+  declaredTagsLen_ = 0;
+}
+
+// --------------------------------------------------------------------------
+//  Memory
+// --------------------------------------------------------------------------
+
+bool LiteOSCParser::reserve(int size, int argCount) {
+  bool ok = true;
+  if (size > bufCapacity_ && (!dynamicBuf_ || !reallocBuf(size))) {
+    ok = false;
+  }
+  if (argCount > argIndexesCapacity_ &&
+      (!dynamicArgIndexes_ || !reallocArgIndexes(argCount))) {
+    ok = false;
+  }
+  return ok;
+}
+
+void LiteOSCParser::shrinkToFit() {
+  if (dynamicBuf_ && bufSize_ < bufCapacity_) {
+    if (bufSize_ == 0) {
+      allocator_->deallocate(ownBuf_, bufCapacity_);
+      ownBuf_ = nullptr;
+      buf_ = nullptr;
+      bufCapacity_ = 0;
+    } else {
+      reallocBuf(bufSize_);
+    }
+  }
+
+  // Keep room for any declared arguments that haven't been added yet
+  int argCount = getArgCount();
+  if (declaredTagsLen_ - 1 > argCount) {
+    argCount = declaredTagsLen_ - 1;
+  }
+  if (dynamicArgIndexes_ && argCount < argIndexesCapacity_) {
+    if (argCount == 0) {
+      allocator_->deallocate(argIndexes_, argIndexesCapacity_ * sizeof(int));
+      argIndexes_ = nullptr;
+      argIndexesCapacity_ = 0;
+    } else {
+      reallocArgIndexes(argCount);
+    }
   }
 }
 
@@ -73,6 +279,9 @@ bool LiteOSCParser::init(const char *address) {
   addressLen_ = 0;
   tagsLen_ = 0;
   bufSize_ = 0;
+  argsResolved_ = 0;
+  addressHashValid_ = false;
+  declaredTagsLen_ = 0;
 
   int addrLen = strlen(address);
   if (addrLen < 1 || address[0] != '/') {
@@ -83,9 +292,10 @@ bool LiteOSCParser::init(const char *address) {
   if (!ensureCapacity(newSize)) {
     return false;
   }
-  strcpy(reinterpret_cast<char *>(buf_), address);
-  memset(&buf_[addrLen + 1], 0, newSize - (addrLen + 1));
+  strcpy(reinterpret_cast<char *>(ownBuf_), address);
+  memset(&ownBuf_[addrLen + 1], 0, newSize - (addrLen + 1));
   addressLen_ = addrLen;
+  indexSegments(address);
   tagsLen_ = 0;
   tagsIndex_ = newSize;
   dataIndex_ = newSize;
@@ -93,22 +303,73 @@ bool LiteOSCParser::init(const char *address) {
   return true;
 }
 
+bool LiteOSCParser::init(const char *address, const char *tags) {
+  if (!init(address)) {
+    return false;
+  }
+  if (tags[0] == '\0' || (tags[0] == ',' && tags[1] == '\0')) {
+    return true;
+  }
+
+  // Check the tags and find the minimum size of the data
+  if (tags[0] != ',') {
+    bufSize_ = 0;
+    addressLen_ = 0;
+    return false;
+  }
+  int tagsLen = 1;
+  int dataSize = 0;
+  for (; tags[tagsLen] != '\0'; tagsLen++) {
+    // Only accept tags that something can fill in
+    char tag = tags[tagsLen];
+    uint8_t info = tagInfo(tag);
+    if ((info & kTagValid) == 0 ||
+        tag == 'c' || tag == 'r' || tag == 'm' || tag == 'S') {
+      bufSize_ = 0;
+      addressLen_ = 0;
+      return false;
+    }
+    dataSize += info & kTagSizeMask;
+    if ((info & (kTagString | kTagBlob)) != 0) {
+      dataSize += 4;
+    }
+  }
+
+  // Reserve what's known up front
+  int tagsSize = align(tagsLen + 1);
+  if (!ensureCapacity(bufSize_ + tagsSize + dataSize) ||
+      !ensureArgIndexesCapacity(tagsLen - 1)) {
+    bufSize_ = 0;
+    addressLen_ = 0;
+    return false;
+  }
+  memcpy(&ownBuf_[bufSize_], tags, tagsLen);
+  memset(&ownBuf_[bufSize_ + tagsLen], 0, tagsSize - tagsLen);
+  tagsIndex_ = bufSize_;
+  tagsLen_ = 1;
+  declaredTagsLen_ = tagsLen;
+  dataIndex_ = tagsIndex_ + tagsSize;
+  bufSize_ = dataIndex_;
+  skipDeclaredEmptyArgs();
+  return true;
+}
+
 bool LiteOSCParser::addInt(int32_t i) {
-  if (!addArg('i', 4)) {
+  if (!addArg('i')) {
     return false;
   }
-  setUint(&buf_[bufSize_ - 4], i);
+  setUint(&ownBuf_[bufSize_ - 4], i);
   return true;
 }
 
 bool LiteOSCParser::addFloat(float f) {
-  if (!addArg('f', 4)) {
+  if (!addArg('f')) {
     return false;
   }
   static_assert(sizeof(float) == 4, "sizeof(float) == 4");
   uint32_t u;
   memcpy(&u, &f, 4);
-  setUint(&buf_[bufSize_ - 4], u);
+  setUint(&ownBuf_[bufSize_ - 4], u);
   return true;
 }
 
@@ -117,7 +378,7 @@ bool LiteOSCParser::addString(const char *s) {
   if (!addArg('s', len)) {
     return false;
   }
-  strcpy(reinterpret_cast<char *>(&buf_[bufSize_ - align(len)]), s);
+  strcpy(reinterpret_cast<char *>(&ownBuf_[bufSize_ - align(len)]), s);
   return true;
 }
 
@@ -128,43 +389,56 @@ bool LiteOSCParser::addBlob(const uint8_t *b, int len) {
   if (!addArg('b', len + 4)) {
     return false;
   }
-  setUint(&buf_[bufSize_ - align(len + 4)], len);
-  memcpy(&buf_[bufSize_ - align(len + 4) + 4], b, len);
+  setUint(&ownBuf_[bufSize_ - align(len + 4)], len);
+  memcpy(&ownBuf_[bufSize_ - align(len + 4) + 4], b, len);
   return true;
 }
 
 bool LiteOSCParser::addLong(int64_t h) {
-  if (!addArg('h', 8)) {
+  if (!addArg('h')) {
     return false;
   }
-  setUlong(&buf_[bufSize_ - 8], h);
+  setUlong(&ownBuf_[bufSize_ - 8], h);
   return true;
 }
 
 bool LiteOSCParser::addTime(uint64_t t) {
-  if (!addArg('t', 8)) {
+  if (!addArg('t')) {
     return false;
   }
-  setUlong(&buf_[bufSize_ - 8], t);
+  setUlong(&ownBuf_[bufSize_ - 8], t);
   return true;
 }
 
 bool LiteOSCParser::addDouble(double d) {
-  if (sizeof(double) != 8 || !addArg('d', 8)) {
+  if (sizeof(double) != 8 || !addArg('d')) {
     return false;
   }
   // static_assert(sizeof(double) == 8, "sizeof(double) == 8");
   uint64_t u;
   memcpy(&u, &d, 8);
-  setUlong(&buf_[bufSize_ - 8], u);
+  setUlong(&ownBuf_[bufSize_ - 8], u);
   return true;
 }
 
 bool LiteOSCParser::addBoolean(bool b) {
-  return addArg(b ? 'T' : 'F', 0);
+  return addArg(b ? 'T' : 'F');
+}
+
+bool LiteOSCParser::addArg(char tag) {
+  return addArg(tag, tagInfo(tag) & kTagSizeMask);
 }
 
 bool LiteOSCParser::addArg(char tag, int argSize) {
+  if (tagsLen_ < declaredTagsLen_) {
+    return addDeclaredArg(tag, argSize);
+  }
+
+  // A lazily-parsed message may not know where its arguments end yet
+  if (!resolveAllArgs()) {
+    return false;
+  }
+
   // Ensure argSize is a multiple of 4
   int newArgSize = align(argSize);
   int tagsSize;  // Includes the NULL
@@ -196,19 +470,21 @@ bool LiteOSCParser::addArg(char tag, int argSize) {
 
   // Case where there's no tags already
   if (tagsLen_ == 0) {
-    buf_[bufSize_ + 0] = ',';
-    buf_[bufSize_ + 1] = tag;
-    buf_[bufSize_ + 2] = '\0';
-    buf_[bufSize_ + 3] = 0;
+    ownBuf_[bufSize_ + 0] = ',';
+    ownBuf_[bufSize_ + 1] = tag;
+    ownBuf_[bufSize_ + 2] = '\0';
+    ownBuf_[bufSize_ + 3] = 0;
     tagsIndex_ = bufSize_;
     tagsLen_ = 2;
     dataIndex_ = tagsIndex_ + 4;
     bufSize_ = newSize;
     argIndexes_[0] = dataIndex_;
+    argsResolved_ = 1;
+    argsEnd_ = bufSize_;
 
     // Now set any extra zeros in the data area
     int delta = newArgSize - argSize;
-    memset(&buf_[bufSize_ - delta], 0, delta);
+    memset(&ownBuf_[bufSize_ - delta], 0, delta);
 
     return true;
   }
@@ -217,10 +493,10 @@ bool LiteOSCParser::addArg(char tag, int argSize) {
   // Remember to include the ',' and the NULL terminators
   int delta = newTagsSize - tagsSize;
   if (delta > 0) {
-    memmove(&buf_[dataIndex_ + delta],
-            &buf_[dataIndex_],
+    memmove(&ownBuf_[dataIndex_ + delta],
+            &ownBuf_[dataIndex_],
             bufSize_ - dataIndex_);
-    memset(&buf_[tagsIndex_ + tagsSize], 0, delta);
+    memset(&ownBuf_[tagsIndex_ + tagsSize], 0, delta);
     dataIndex_ += delta;
     bufSize_ += delta;
     for (int i = 0; i < newArgCount - 1; i++) {
@@ -229,18 +505,207 @@ bool LiteOSCParser::addArg(char tag, int argSize) {
   }
   argIndexes_[newArgCount - 1] = bufSize_;
 
-  buf_[tagsIndex_ + tagsLen_] = tag;
+  ownBuf_[tagsIndex_ + tagsLen_] = tag;
   tagsLen_++;
-  buf_[tagsIndex_ + tagsLen_] = '\0';
+  ownBuf_[tagsIndex_ + tagsLen_] = '\0';
 
   // Now set any extra zeros in the data area
   delta = newArgSize - argSize;
-  memset(&buf_[bufSize_ + argSize], 0, delta);
+  memset(&ownBuf_[bufSize_ + argSize], 0, delta);
+  bufSize_ += newArgSize;
+  argsResolved_ = newArgCount;
+  argsEnd_ = bufSize_;
+
+  return true;
+}
+
+bool LiteOSCParser::addDeclaredArg(char tag, int argSize) {
+  // Booleans can be either value
+  char declared = ownBuf_[tagsIndex_ + tagsLen_];
+  if (tag != declared &&
+      (tagInfo(tag) & tagInfo(declared) & kTagBoolean) == 0) {
+    return false;
+  }
+
+  int newArgSize = align(argSize);
+  if (!ensureCapacity(bufSize_ + newArgSize)) {
+    return false;
+  }
+  ownBuf_[tagsIndex_ + tagsLen_] = tag;
+  argIndexes_[tagsLen_ - 1] = bufSize_;
+  tagsLen_++;
+
+  // Set any extra zeros in the data area
+  if (newArgSize != argSize) {
+    memset(&ownBuf_[bufSize_ + argSize], 0, newArgSize - argSize);
+  }
   bufSize_ += newArgSize;
+  skipDeclaredEmptyArgs();
+  return true;
+}
+
+void LiteOSCParser::skipDeclaredEmptyArgs() {
+  while (tagsLen_ < declaredTagsLen_ &&
+         tagInfo(ownBuf_[tagsIndex_ + tagsLen_]) == kTagValid) {
+    argIndexes_[tagsLen_ - 1] = bufSize_;
+    tagsLen_++;
+  }
+  argsResolved_ = tagsLen_ - 1;
+  argsEnd_ = bufSize_;
+}
 
+bool LiteOSCParser::resolveAllArgs() {
+  int argCount = getArgCount();
+  if (argsResolved_ < argCount) {
+    if (resolveArgs(argCount - 1) == nullptr) {
+      return false;
+    }
+    bufSize_ = argsEnd_;
+  }
   return true;
 }
 
+// --------------------------------------------------------------------------
+//  Changing arguments in place
+// --------------------------------------------------------------------------
+
+bool LiteOSCParser::setInt(int index, int32_t i) {
+  if (!isInt(index)) {
+    return false;
+  }
+  uint8_t *data = ownArgData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  setUint(data, i);
+  return true;
+}
+
+bool LiteOSCParser::setFloat(int index, float f) {
+  if (!isFloat(index)) {
+    return false;
+  }
+  uint8_t *data = ownArgData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  static_assert(sizeof(float) == 4, "sizeof(float) == 4");
+  uint32_t u;
+  memcpy(&u, &f, 4);
+  setUint(data, u);
+  return true;
+}
+
+bool LiteOSCParser::setLong(int index, int64_t h) {
+  if (!isLong(index)) {
+    return false;
+  }
+  uint8_t *data = ownArgData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  setUlong(data, h);
+  return true;
+}
+
+bool LiteOSCParser::setTime(int index, uint64_t t) {
+  if (!isTime(index)) {
+    return false;
+  }
+  uint8_t *data = ownArgData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  setUlong(data, t);
+  return true;
+}
+
+bool LiteOSCParser::setDouble(int index, double d) {
+  if (sizeof(double) != 8 || !isDouble(index)) {
+    return false;
+  }
+  uint8_t *data = ownArgData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  // static_assert(sizeof(double) == 8, "sizeof(double) == 8");
+  uint64_t u;
+  memcpy(&u, &d, 8);
+  setUlong(data, u);
+  return true;
+}
+
+bool LiteOSCParser::setBoolean(int index, bool b) {
+  if (!isBoolean(index)) {
+    return false;
+  }
+  ownBuf_[tagsIndex_ + 1 + index] = b ? 'T' : 'F';
+  return true;
+}
+
+bool LiteOSCParser::setString(int index, const char *s) {
+  if (!isString(index)) {
+    return false;
+  }
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  int oldSize = align(strlen(reinterpret_cast<const char *>(data)) + 1);
+  int len = strlen(s) + 1;
+  int newSize = align(len);
+  uint8_t *p = resizeArg(index, oldSize, newSize);
+  if (p == nullptr) {
+    return false;
+  }
+  memcpy(p, s, len);
+  memset(&p[len], 0, newSize - len);
+  return true;
+}
+
+bool LiteOSCParser::setBlob(int index, const uint8_t *b, int len) {
+  if (len < 0 || !isBlob(index)) {
+    return false;
+  }
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  int oldSize = align(getUint(data) + 4);
+  int newSize = align(len + 4);
+  uint8_t *p = resizeArg(index, oldSize, newSize);
+  if (p == nullptr) {
+    return false;
+  }
+  setUint(p, len);
+  memcpy(&p[4], b, len);
+  memset(&p[4 + len], 0, newSize - (4 + len));
+  return true;
+}
+
+uint8_t *LiteOSCParser::resizeArg(int index, int oldSize, int newSize) {
+  // Everything after this argument needs a known position
+  if (!resolveAllArgs()) {
+    return nullptr;
+  }
+  int off = argIndexes_[index];
+  int delta = newSize - oldSize;
+  if (delta == 0) {
+    return &ownBuf_[off];
+  }
+  if (!ensureCapacity(bufSize_ + delta)) {
+    return nullptr;
+  }
+  memmove(&ownBuf_[off + newSize], &ownBuf_[off + oldSize],
+          bufSize_ - (off + oldSize));
+  for (int i = index + 1; i < getArgCount(); i++) {
+    argIndexes_[i] += delta;
+  }
+  bufSize_ += delta;
+  argsEnd_ = bufSize_;
+  return &ownBuf_[off];
+}
+
 // --------------------------------------------------------------------------
 //  Parsing and matching
 // --------------------------------------------------------------------------
@@ -258,11 +723,13 @@ bool LiteOSCParser::addArg(char tag, int argSize) {
 // 2 -> 1
 // 3 -> 0
 
-bool LiteOSCParser::parse(const uint8_t *buf, int len) {
+bool OSCMessageView::parse(const uint8_t *buf, int len) {
   memoryErr_ = false;
   addressLen_ = 0;
   tagsLen_ = 0;
   bufSize_ = 0;
+  argsResolved_ = 0;
+  addressHashValid_ = false;
 
   if ((len & 0x03) != 0 || len <= 0) {
     return false;
@@ -278,20 +745,20 @@ bool LiteOSCParser::parse(const uint8_t *buf, int len) {
     return false;
   }
   addressLen_ = index - 1;
+  indexSegments(reinterpret_cast<const char *>(buf));
+  if (hashAddress_) {
+    // The address was just scanned, so it's likely still in the cache
+    addressHash_ = hashAddress(reinterpret_cast<const char *>(buf),
+                               addressLen_);
+    addressHashValid_ = true;
+  }
   index = align(index);
 
   // Type tags
 
   // No tags
   if (index >= len || buf[index] != ',') {
-    if (!ensureCapacity(index)) {
-      addressLen_ = 0;
-      tagsLen_ = 0;
-      return false;
-    }
-    memcpy(buf_, buf, index);
-    memset(&buf_[addressLen_ + 1], 0, index - (addressLen_ + 1));
-
+    buf_ = buf;
     tagsIndex_ = index;
     tagsLen_ = 0;
     dataIndex_ = index;
@@ -308,14 +775,7 @@ bool LiteOSCParser::parse(const uint8_t *buf, int len) {
   }
   tagsLen_ = index - 1 - tagsIndex_;
   if (tagsLen_ == 1) {
-    if (!ensureCapacity(tagsIndex_)) {
-      addressLen_ = 0;
-      tagsLen_ = 0;
-      return false;
-    }
-    memcpy(buf_, buf, tagsIndex_);
-    memset(&buf_[addressLen_ + 1], 0, tagsIndex_ - (addressLen_ + 1));
-
+    buf_ = buf;
     tagsLen_ = 0;
     dataIndex_ = tagsIndex_;
     bufSize_ = tagsIndex_;
@@ -330,38 +790,65 @@ bool LiteOSCParser::parse(const uint8_t *buf, int len) {
     return false;
   }
   dataIndex_ = index;
-  index = parseArgs(buf, index, len);
+  if (lazyArgs_) {
+    index = checkArgs(buf, index, len);
+  } else {
+    index = parseArgs(buf, index, len);
+  }
   if (index < 0) {
     addressLen_ = 0;
     tagsLen_ = 0;
     return false;
   }
 
-  if (!ensureCapacity(index)) {
+  buf_ = buf;
+  bufSize_ = index;
+  if (lazyArgs_) {
+    argsResolved_ = 0;
+    argsEnd_ = dataIndex_;
+  } else {
+    argsResolved_ = tagsLen_ - 1;
+    argsEnd_ = index;
+  }
+
+  return true;
+}
+
+bool LiteOSCParser::parse(const uint8_t *buf, int len) {
+  declaredTagsLen_ = 0;
+  bool ok = OSCMessageView::parse(buf, len);
+  buf_ = ownBuf_;
+  if (!ok) {
+    return false;
+  }
+
+  if (!ensureCapacity(bufSize_)) {
     addressLen_ = 0;
     tagsLen_ = 0;
+    bufSize_ = 0;
     return false;
   }
-  memcpy(buf_, buf, index);
-  memset(&buf_[addressLen_ + 1], 0, tagsIndex_ - (addressLen_ + 1));
-  memset(&buf_[tagsIndex_ + tagsLen_ + 1], 0,
-         dataIndex_ - (tagsIndex_ + tagsLen_ + 1));
-  bufSize_ = index;
+  memcpy(ownBuf_, buf, bufSize_);
+  memset(&ownBuf_[addressLen_ + 1], 0, tagsIndex_ - (addressLen_ + 1));
+  if (tagsLen_ > 0) {
+    memset(&ownBuf_[tagsIndex_ + tagsLen_ + 1], 0,
+           dataIndex_ - (tagsIndex_ + tagsLen_ + 1));
+  }
 
   return true;
 }
 
-bool LiteOSCParser::fullMatch(int offset, const char *pattern) const {
+bool OSCMessageView::fullMatch(int offset, const char *pattern) const {
   if (offset < 0 || addressLen_ < offset) {
     return false;
   }
   if (offset == addressLen_) {
     return strlen(pattern) == 0;
   }
-  return strcmp(reinterpret_cast<char *>(&buf_[offset]), pattern) == 0;
+  return strcmp(reinterpret_cast<const char *>(&buf_[offset]), pattern) == 0;
 }
 
-int LiteOSCParser::match(int offset, const char *pattern) const {
+int OSCMessageView::match(int offset, const char *pattern) const {
   if (offset < 0 || addressLen_ < offset) {
     return -1;
   }
@@ -373,7 +860,7 @@ int LiteOSCParser::match(int offset, const char *pattern) const {
   }
 
   int loc;
-  if (strcmploc(reinterpret_cast<char *>(&buf_[offset]), pattern, &loc)) {
+  if (strcmploc(reinterpret_cast<const char *>(&buf_[offset]), pattern, &loc)) {
     return addressLen_;
   }
   loc += offset;
@@ -391,7 +878,7 @@ int LiteOSCParser::match(int offset, const char *pattern) const {
 
 // Similar to:
 // https://github.com/ARM-software/arm-trusted-firmware/blob/master/lib/stdlib/strcmp.c
-bool LiteOSCParser::strcmploc(const char *s1, const char *s2, int *loc) {
+bool OSCMessageView::strcmploc(const char *s1, const char *s2, int *loc) {
   int count = 0;
   while (*s1 == *(s2++)) {
     if (*(s1++) == '\0') {
@@ -407,11 +894,68 @@ bool LiteOSCParser::strcmploc(const char *s1, const char *s2, int *loc) {
 //  Getters
 // --------------------------------------------------------------------------
 
-const char *LiteOSCParser::getAddress() const {
-  return reinterpret_cast<char *>(&buf_[0]);
+const char *OSCMessageView::getAddress() const {
+  return reinterpret_cast<const char *>(&buf_[0]);
+}
+
+void OSCMessageView::indexSegments(const char *addr) {
+  const char *end = &addr[addressLen_];
+  int count = 0;
+  const char *p = addr;
+  while (p != nullptr) {
+    p++;  // Skip the '/'
+    if (count < kMaxSegments) {
+      segments_[count] = p - addr;
+    }
+    count++;
+    p = static_cast<const char *>(memchr(p, '/', end - p));
+  }
+  segmentCount_ = count;
+}
+
+const char *OSCMessageView::getSegment(int index, int *len) const {
+  if (index < 0 || getSegmentCount() <= index) {
+    *len = 0;
+    return nullptr;
+  }
+  const char *addr = getAddress();
+  const char *end = &addr[addressLen_];
+
+  // Segments past the recorded ones are found from the last one
+  const char *start;
+  if (index < kMaxSegments) {
+    start = &addr[segments_[index]];
+  } else {
+    start = &addr[segments_[kMaxSegments - 1]];
+    for (int i = kMaxSegments - 1; i < index; i++) {
+      start = static_cast<const char *>(memchr(start, '/', end - start)) + 1;
+    }
+  }
+  const char *next =
+      static_cast<const char *>(memchr(start, '/', end - start));
+  *len = ((next != nullptr) ? next : end) - start;
+  return start;
+}
+
+bool OSCMessageView::matchSegment(int index, const char *literal) const {
+  int len;
+  const char *seg = getSegment(index, &len);
+  if (seg == nullptr) {
+    return false;
+  }
+  return static_cast<int>(strlen(literal)) == len &&
+         memcmp(seg, literal, len) == 0;
+}
+
+uint32_t OSCMessageView::hashAddress(const char *s, int len) {
+  uint32_t h = kFnvOffsetBasis;
+  for (int i = 0; i < len; i++) {
+    h = (h ^ static_cast<uint8_t>(s[i])) * kFnvPrime;
+  }
+  return h;
 }
 
-int32_t LiteOSCParser::getInt(int index) const {
+int32_t OSCMessageView::getInt(int index) const {
   int32_t v;
   if (!getIfInt(index, &v)) {
     return 0;
@@ -419,15 +963,19 @@ int32_t LiteOSCParser::getInt(int index) const {
   return v;
 }
 
-bool LiteOSCParser::getIfInt(int index, int32_t *v) const {
+bool OSCMessageView::getIfInt(int index, int32_t *v) const {
   if (!isInt(index)) {
     return false;
   }
-  *v = getUint(&buf_[argIndexes_[index]]);
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  *v = getUint(data);
   return true;
 }
 
-float LiteOSCParser::getFloat(int index) const {
+float OSCMessageView::getFloat(int index) const {
   float v;
   if (!getIfFloat(index, &v)) {
     return 0.0f;
@@ -435,42 +983,58 @@ float LiteOSCParser::getFloat(int index) const {
   return v;
 }
 
-bool LiteOSCParser::getIfFloat(int index, float *v) const {
+bool OSCMessageView::getIfFloat(int index, float *v) const {
   if (!isFloat(index)) {
     return false;
   }
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
   static_assert(sizeof(float) == 4, "sizeof(float) == 4");
-  uint32_t u = getUint(&buf_[argIndexes_[index]]);
+  uint32_t u = getUint(data);
   memcpy(v, &u, 4);
   return true;
 }
 
-const char *LiteOSCParser::getString(int index) const {
+const char *OSCMessageView::getString(int index) const {
   if (!isString(index)) {
     return nullptr;
   }
-  return reinterpret_cast<char *>(&buf_[argIndexes_[index]]);
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return nullptr;
+  }
+  return reinterpret_cast<const char *>(data);
 }
 
-int LiteOSCParser::getBlobLength(int index) const {
+int OSCMessageView::getBlobLength(int index) const {
   if (!isBlob(index)) {
     return 0;
   }
-  int32_t size = getUint(&buf_[argIndexes_[index]]);
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return 0;
+  }
+  int32_t size = getUint(data);
   if (size < 0) {
     size = 0;
   }
   return size;
 }
 
-const uint8_t *LiteOSCParser::getBlob(int index) const {
+const uint8_t *OSCMessageView::getBlob(int index) const {
   if (!isBlob(index)) {
     return nullptr;
   }
-  return &buf_[argIndexes_[index] + 4];
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return nullptr;
+  }
+  return &data[4];
 }
 
-int64_t LiteOSCParser::getLong(int index) const {
+int64_t OSCMessageView::getLong(int index) const {
   int64_t v;
   if (!getIfLong(index, &v)) {
     return 0;
@@ -478,15 +1042,19 @@ int64_t LiteOSCParser::getLong(int index) const {
   return v;
 }
 
-bool LiteOSCParser::getIfLong(int index, int64_t *v) const {
+bool OSCMessageView::getIfLong(int index, int64_t *v) const {
   if (!isLong(index)) {
     return false;
   }
-  *v = getUlong(&buf_[argIndexes_[index]]);
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  *v = getUlong(data);
   return true;
 }
 
-uint64_t LiteOSCParser::getTime(int index) const {
+uint64_t OSCMessageView::getTime(int index) const {
   uint64_t v;
   if (!getIfTime(index, &v)) {
     return 0;
@@ -494,15 +1062,19 @@ uint64_t LiteOSCParser::getTime(int index) const {
   return v;
 }
 
-bool LiteOSCParser::getIfTime(int index, uint64_t *v) const {
+bool OSCMessageView::getIfTime(int index, uint64_t *v) const {
   if (!isTime(index)) {
     return false;
   }
-  *v = getUlong(&buf_[argIndexes_[index]]);
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  *v = getUlong(data);
   return true;
 }
 
-double LiteOSCParser::getDouble(int index) const {
+double OSCMessageView::getDouble(int index) const {
   double v;
   if (!getIfDouble(index, &v)) {
     return 0.0;
@@ -510,17 +1082,21 @@ double LiteOSCParser::getDouble(int index) const {
   return v;
 }
 
-bool LiteOSCParser::getIfDouble(int index, double *v) const {
+bool OSCMessageView::getIfDouble(int index, double *v) const {
   if (sizeof(double) != 8 || !isDouble(index)) {
     return false;
   }
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
   // static_assert(sizeof(double) == 8, "sizeof(double) == 8");
-  uint64_t u = getUlong(&buf_[argIndexes_[index]]);
+  uint64_t u = getUlong(data);
   memcpy(v, &u, 8);
   return true;
 }
 
-int32_t LiteOSCParser::getChar(int index) const {
+int32_t OSCMessageView::getChar(int index) const {
   int32_t v;
   if (!getIfChar(index, &v)) {
     return 0;
@@ -528,15 +1104,19 @@ int32_t LiteOSCParser::getChar(int index) const {
   return v;
 }
 
-bool LiteOSCParser::getIfChar(int index, int32_t *v) const {
+bool OSCMessageView::getIfChar(int index, int32_t *v) const {
   if (!isChar(index)) {
     return false;
   }
-  *v = getUint(&buf_[argIndexes_[index]]);
+  const uint8_t *data = argData(index);
+  if (data == nullptr) {
+    return false;
+  }
+  *v = getUint(data);
   return true;
 }
 
-bool LiteOSCParser::getBoolean(int index) const {
+bool OSCMessageView::getBoolean(int index) const {
   bool v;
   if (!getIfBoolean(index, &v)) {
     return false;
@@ -544,7 +1124,7 @@ bool LiteOSCParser::getBoolean(int index) const {
   return v;
 }
 
-bool LiteOSCParser::getIfBoolean(int index, bool *v) const {
+bool OSCMessageView::getIfBoolean(int index, bool *v) const {
   if (!isBoolean(index)) {
     return false;
   }
@@ -567,16 +1147,34 @@ bool LiteOSCParser::ensureCapacity(int size) {
     memoryErr_ = true;
     return false;
   }
-  buf_ = static_cast<uint8_t *>(realloc(buf_, size));
-  if (buf_ == nullptr) {
+
+  // Grow by half again so that repeated additions don't reallocate every
+  // time, but fall back to the exact size if that much isn't available
+  int newCapacity = bufCapacity_ + bufCapacity_/2;
+  if (newCapacity < size) {
+    newCapacity = size;
+  }
+  if (!reallocBuf(newCapacity) && (newCapacity == size || !reallocBuf(size))) {
     memoryErr_ = true;
     return false;
   }
-  bufCapacity_ = size;
   return true;
 }
 
-bool LiteOSCParser::ensureArgIndexesCapacity(int size) {
+bool LiteOSCParser::reallocBuf(int capacity) {
+  uint8_t *p = static_cast<uint8_t *>(
+      allocator_->reallocate(ownBuf_, bufCapacity_, capacity));
+  if (p == nullptr) {
+    return false;
+  }
+  ownBuf_ = p;
+  buf_ = ownBuf_;
+  bufCapacity_ = capacity;
+  reallocCount_++;
+  return true;
+}
+
+bool OSCMessageView::ensureArgIndexesCapacity(int size) {
   if (size <= argIndexesCapacity_) {
     return true;
   }
@@ -584,79 +1182,177 @@ bool LiteOSCParser::ensureArgIndexesCapacity(int size) {
     memoryErr_ = true;
     return false;
   }
-  argIndexes_ = static_cast<int *>(realloc(argIndexes_, size * sizeof(int)));
-  if (argIndexes_ == nullptr) {
+
+  // Grow the same way as the message buffer
+  int newCapacity = argIndexesCapacity_ + argIndexesCapacity_/2;
+  if (newCapacity < size) {
+    newCapacity = size;
+  }
+  if (!reallocArgIndexes(newCapacity) &&
+      (newCapacity == size || !reallocArgIndexes(size))) {
     memoryErr_ = true;
     return false;
   }
-  argIndexesCapacity_ = size;
   return true;
 }
 
-int LiteOSCParser::parseString(const uint8_t *buf, int off, int len) {
-  while (buf[off++] != 0) {
-    if (off >= len) {
+bool OSCMessageView::reallocArgIndexes(int capacity) {
+  int *p = static_cast<int *>(allocator_->reallocate(
+      argIndexes_, argIndexesCapacity_ * sizeof(int), capacity * sizeof(int)));
+  if (p == nullptr) {
+    return false;
+  }
+  argIndexes_ = p;
+  argIndexesCapacity_ = capacity;
+  reallocCount_++;
+  return true;
+}
+
+int OSCMessageView::parseString(const uint8_t *buf, int off, int len) {
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  while (off + 16 <= len) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&buf[off]));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+    if (mask != 0) {
+      return off + __builtin_ctz(mask) + 1;
+    }
+    off += 16;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  while (off + 16 <= len) {
+    uint8x16_t v = vceqzq_u8(vld1q_u8(&buf[off]));
+    if (vmaxvq_u8(v) != 0) {
+      break;
+    }
+    off += 16;
+  }
+#endif
+
+#if !defined(__AVR__) && !defined(__ARM_ARCH_6M__)
+  // Word at a time; skipped where unaligned 32-bit loads are slow
+  while (off + 4 <= len) {
+    uint32_t w;
+    memcpy(&w, &buf[off], 4);
+    // Non-zero if and only if some byte is zero
+    if (((w - uint32_t{0x01010101}) & ~w & uint32_t{0x80808080}) != 0) {
+      break;
+    }
+    off += 4;
+  }
+#endif
+
+  while (off < len) {
+    if (buf[off++] == 0) {
+      return off;
+    }
+  }
+  return -1;
+}
+
+int OSCMessageView::parseArgs(const uint8_t *buf, int off, int len) {
+  // Each fixed-size argument adds at most 8, so make sure the sum of
+  // those can't overflow before checking it at the end
+  int argCount = tagsLen_ - 1;
+  if (argCount > (INT_MAX - len) / 8) {
+    return -1;
+  }
+
+  // Fixed-size arguments just add their size from the table; only the
+  // variable-length ones need to look at the data. Invalid tags have a
+  // zero descriptor, which clears 'valid' and is checked once at the end.
+  const uint8_t *tags = &buf[tagsIndex_ + 1];
+  uint8_t valid = kTagValid;
+  for (int i = 0; i < argCount; i++) {
+    argIndexes_[i] = off;
+    uint8_t info = tagInfo(tags[i]);
+    valid &= info;
+    if ((info & (kTagString | kTagBlob)) == 0) {
+      off += info & kTagSizeMask;
+      continue;
+    }
+
+    off = skipVariableArg(buf, off, len, info);
+    if (off < 0) {
       return -1;
     }
   }
+  if (valid == 0 || off > len) {
+    return -1;
+  }
   return off;
 }
 
-int LiteOSCParser::parseArgs(const uint8_t *buf, int off, int len) {
-  for (int i = 0; i < tagsLen_ - 1; i++) {
-    argIndexes_[i] = off;
-    switch (buf[i + tagsIndex_ + 1]) {
-      case 'i':  // int32
-      case 'f':  // float32
-      case 'c':  // char
-      case 'r':  // RGBA
-      case 'm':  // MIDI
-        off += 4;
-        break;
-
-      case 'h':  // int64
-      case 't':  // timetag
-      case 'd':  // float64
-        off += 8;
-        break;
-
-      case 's':  // OSC-string
-      case 'S':  // symbol, same as string
-        off = parseString(buf, off, len);
-        if (off < 0) {
-          return -1;
-        }
-        off = align(off);
-        break;
-
-      case 'b': {  // OSC-blob
-        if (off + 4 > len) {
-          return -1;
-        }
-        int32_t size = getUint(&buf[off]);
-        if (size < 0) {
-          return -1;
-        }
-        off = align(off + 4 + size);
-        break;
-      }
+int OSCMessageView::checkArgs(const uint8_t *buf, int off, int len) {
+  int argCount = tagsLen_ - 1;
+  if (argCount > (INT_MAX - len) / 8) {
+    return -1;
+  }
 
-      case 'T':  // True
-      case 'F':  // False
-      case 'N':  // Nil
-      case 'I':  // Infinitum
-      case '[':  // Array begin
-      case ']':  // Array end
-        break;
+  // Strings and blobs take at least 4 bytes
+  const uint8_t *tags = &buf[tagsIndex_ + 1];
+  uint8_t valid = kTagValid;
+  int fixedSize = 0;
+  int variableCount = 0;
+  for (int i = 0; i < argCount; i++) {
+    uint8_t info = tagInfo(tags[i]);
+    valid &= info;
+    fixedSize += info & kTagSizeMask;
+    variableCount += (info & (kTagString | kTagBlob)) != 0;
+  }
+  if (valid == 0 || len - off < fixedSize + 4*variableCount) {
+    return -1;
+  }
+  if (variableCount == 0) {
+    return off + fixedSize;
+  }
+  return len;
+}
 
-      default:
-        return -1;
-    }
-    if (off > len) {
+int OSCMessageView::skipVariableArg(const uint8_t *buf, int off, int len,
+                                    uint8_t info) {
+  if ((info & kTagString) != 0) {
+    off = parseString(buf, off, len);
+    if (off < 0) {
       return -1;
     }
+    return align(off);
   }
-  return off;
+
+  // OSC-blob
+  if (len - off < 4) {
+    return -1;
+  }
+  int32_t size = getUint(&buf[off]);
+  if (size < 0 || size > len - off - 4) {
+    return -1;
+  }
+  return align(off + 4 + size);
+}
+
+const uint8_t *OSCMessageView::resolveArgs(int index) const {
+  const uint8_t *tags = &buf_[tagsIndex_ + 1];
+  int off = argsEnd_;
+  for (int i = argsResolved_; i <= index; i++) {
+    uint8_t info = tagInfo(tags[i]);
+    int next;
+    if ((info & (kTagString | kTagBlob)) == 0) {
+      next = off + (info & kTagSizeMask);
+      if (next > bufSize_) {
+        return nullptr;
+      }
+    } else {
+      next = skipVariableArg(buf_, off, bufSize_, info);
+      if (next < 0) {
+        return nullptr;
+      }
+    }
+    argIndexes_[i] = off;
+    argsResolved_ = i + 1;
+    argsEnd_ = next;
+    off = next;
+  }
+  return &buf_[argIndexes_[index]];
 }
 
 }  // namespace osc
@@ -12,108 +12,94 @@
 #else
 #include <stdint.h>
 #endif
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
 #else
 #include <cstdint>
+#include <cstring>
+#endif
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
 #endif
 
+// Project includes
+#include "OSCAllocator.h"
+
 namespace qindesign {
 namespace osc {
 
-// LiteOSCParser parses and constructs OSC messages. The internal buffer
-// and argument list can be either dynamically allocated or set to a
-// specific size. Any functions that add to, initialize, or change the
-// message return whether they were successful. One of the possible
-// reasons for failure is that there's not enough space in one of the
-// internal buffers, and more cannot be allocated. The isMemoryError()
-// function can be used to determine this case.
-//
-// One strategy when creating a message would be to add everything needed
-// and then check for a memory error afterwards, instead of after every
-// addition.
+// OSCMessageView parses OSC messages in place, without copying them.
+// It keeps pointers into the caller's buffer, so that buffer must remain
+// valid and unchanged for as long as the view is used. Only the argument
+// index list is stored internally, and, like the one in LiteOSCParser,
+// it can be either dynamically allocated or set to a specific size. If
+// it has a fixed size then parsing never allocates memory.
 //
-// Some of the functions return a pointer to a spot in the internal buffer.
-// Try not to mismanage those. :)
-class LiteOSCParser {
+// All the getters and matching functions are defined here. LiteOSCParser
+// extends this with its own buffer and the ability to construct messages.
+class OSCMessageView {
  public:
-  // Creates a new OSC parser. The maximum buffer size and argument count
-  // are given. If the buffer size is non-positive then the buffer will be
-  // dynamically allocated as needed. The size should be a multiple of four.
-  //
-  // Similarly, if the maximum argument count, maxArgCount, is non-positive,
-  // then the internal array will be dynamically allocated as needed.
-  // Otherwise, the maxmimum number of arguments in a message will be
-  // limited to that count.
+  // The number of address segments whose positions are recorded.
+  static constexpr int kMaxSegments = 8;
+
+  // Creates a new view. If the maximum argument count, maxArgCount, is
+  // non-positive then the internal argument index array will be
+  // dynamically allocated as needed. Otherwise, the maximum number of
+  // arguments in a message will be limited to that count.
   //
-  // The buffer size, bufSize, is given in bytes, and the maximum argument
-  // count, maxArgCount, is given in ints, i.e. maxArgCount*sizeof(int).
-  LiteOSCParser(int bufSize, int maxArgCount);
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCMessageView(int maxArgCount, OSCAllocator *allocator = nullptr);
 
-  // Initializes a new OSC parser having dynamic buffer and argument
-  // allocation.
-  LiteOSCParser() : LiteOSCParser(0, 0) {}
+  // Creates a new view having dynamic argument allocation.
+  OSCMessageView() : OSCMessageView(0) {}
 
   // Not copyable
-  LiteOSCParser(const LiteOSCParser &) = delete;
-  LiteOSCParser &operator=(const LiteOSCParser &) = delete;
-
-  ~LiteOSCParser();
+  OSCMessageView(const OSCMessageView &) = delete;
+  OSCMessageView &operator=(const OSCMessageView &) = delete;
 
-  // ------------------------------------------------------------------------
-  //  Creating
-  // ------------------------------------------------------------------------
+  // Movable. The argument index array and its fixed or dynamic setting,
+  // along with the allocator, go with the parsed message. The moved-from
+  // view is left empty, with a dynamic argument index array.
+  OSCMessageView(OSCMessageView &&other) noexcept;
+  OSCMessageView &operator=(OSCMessageView &&other) noexcept;
 
-  // Initializes the message with a new address and no arguments. This
-  // returns whether the initialization was successful. This will be
-  // unsuccessful if the address does not start with a '/' or if there
-  // isn't enough space in the internal buffer. The second condition can
-  // be checked with a call to isMemoryError().
-  bool init(const char *address);
+  // Swaps the contents of this view with another.
+  void swap(OSCMessageView &other) noexcept;
 
-  // Clears the message. Under the covers, this calls init with an
-  // empty string and then ignores the result.
-  void clear() {
-    init("");
-  }
+  ~OSCMessageView();
 
   // Gets the total size of the encoded message.
   int getMessageSize() const {
     return bufSize_;
   }
 
-  // Gets a pointer to the internal buffer, for sending the data elsewhere.
-  // See getMessageSize() to retrieve the size.
+  // Gets a pointer to the start of the message. For a view, this points
+  // into the buffer that was parsed. See getMessageSize() to retrieve
+  // the size.
   const uint8_t *getMessageBuf() const {
     return buf_;
   }
 
-  // Adds a 32-bit int argument.
-  bool addInt(int32_t i);
-
-  // Adds a 32-bit float argument.
-  bool addFloat(float f);
-
-  // Adds a string.
-  bool addString(const char *s);
-
-  // Adds a blob having the given length.
-  bool addBlob(const uint8_t *b, int len);
-
-  // Adds a 64-bit long argument.
-  bool addLong(int64_t h);
-
-  // Adds a 64-bit time argument.
-  bool addTime(uint64_t t);
-
-  // Adds a 64-bit double argument.
-  //
-  // This will return `false` if the size of type `double` is not 8 bytes.
-  bool addDouble(double d);
+  // Returns the current capacity of the argument index array, in number of
+  // arguments.
+  int getArgCapacity() const {
+    return argIndexesCapacity_;
+  }
 
-  // Adds a boolean.
-  bool addBoolean(bool b);
+  // Returns the number of times an internal array has been reallocated.
+  // This is useful for choosing fixed sizes from real traffic.
+  int getReallocCount() const {
+    return reallocCount_;
+  }
 
-  // Returns whether an insufficient buffer size is preventing the latest
-  // message from being constructed.
+  // Returns whether an insufficient argument index size is preventing the
+  // latest message from being parsed. For LiteOSCParser, this also
+  // includes the internal message buffer.
   bool isMemoryError() const {
     return memoryErr_;
   }
@@ -122,11 +108,53 @@ class LiteOSCParser {
   //  Parsing and matching
   // ------------------------------------------------------------------------
 
-  // Parses the given buffer and returns whether the message is valid.
-  // If this returns 'false' then isMemoryError() can be used to determine
-  // whether the failure was due to not enough space in the internal buffer.
+  // Parses the given buffer in place and returns whether the message is
+  // valid. Nothing is copied; all the getters return values from, or
+  // pointers into, the given buffer. If this returns 'false' then
+  // isMemoryError() can be used to determine whether the failure was due
+  // to not enough space for the argument indexes.
   bool parse(const uint8_t *buf, int len);
 
+  // Sets whether argument offsets are found lazily. Normally, parsing
+  // walks all the arguments and records where each one starts. In lazy
+  // mode, parsing only checks the type tags and that the message is long
+  // enough to hold the arguments, and offsets are found as the arguments
+  // are read, up to the highest index read so far. This makes reading
+  // only the first few arguments of a large message much cheaper.
+  //
+  // Note that a malformed string or blob is then not detected until it,
+  // or an argument after it, is read, and the getter will behave as if
+  // the argument were the wrong type. As well, getMessageSize() may
+  // include any trailing bytes when there are variable-length arguments.
+  // Because the getters update the offsets, a lazily-parsed message must
+  // not be read from more than one thread at a time.
+  //
+  // This takes effect on the next parse.
+  void setLazyArgs(bool flag) {
+    lazyArgs_ = flag;
+  }
+
+  // Returns whether argument offsets are found lazily.
+  bool isLazyArgs() const {
+    return lazyArgs_;
+  }
+
+  // Sets whether the address hash is computed when parsing. Otherwise,
+  // it's computed the first time getAddressHash() is called for each
+  // message. Computing it up front keeps the cost out of the handlers,
+  // and means that a parsed message can then be read from multiple
+  // threads.
+  //
+  // This takes effect on the next parse.
+  void setHashAddress(bool flag) {
+    hashAddress_ = flag;
+  }
+
+  // Returns whether the address hash is computed when parsing.
+  bool isHashAddress() const {
+    return hashAddress_;
+  }
+
   // Returns whether the address fully matches the given pattern,
   // starting at offset in the address.
   bool fullMatch(int offset, const char *pattern) const;
@@ -146,9 +174,59 @@ class LiteOSCParser {
   // ------------------------------------------------------------------------
 
   // Gets a pointer to the address. This returns a pointer into the
-  // internal buffer.
+  // message buffer.
   const char *getAddress() const;
 
+  // Returns the number of '/'-separated segments in the address. For
+  // example, "/mixer/ch/1" has three. The starting position of the first
+  // kMaxSegments segments is recorded when the address is parsed or
+  // built, so that those can be found without scanning.
+  int getSegmentCount() const {
+    return (addressLen_ == 0) ? 0 : segmentCount_;
+  }
+
+  // Returns a pointer to the start of the segment at the given index and
+  // sets len to its length, not including any '/'. For example, segment
+  // 1 of "/mixer/ch/1" is "ch", with length 2. The segment isn't NULL-
+  // terminated. This returns nullptr and sets len to zero if the index is
+  // out of range.
+  const char *getSegment(int index, int *len) const;
+
+  // Returns whether the segment at the given index is exactly the given
+  // string. The lengths are compared before the characters.
+  bool matchSegment(int index, const char *literal) const;
+
+  // Returns a 32-bit FNV-1a hash of the address. This is the same value
+  // as hashAddress(getAddress()), so it can be compared against
+  // addresses hashed at compile time, for example:
+  //
+  //   switch (osc.getAddressHash()) {
+  //     case OSC_ADDR("/mix/volume"):
+  //       if (osc.fullMatch(0, "/mix/volume")) { ... }
+  //       break;
+  //   }
+  //
+  // Different addresses can have the same hash, so a match should be
+  // confirmed with fullMatch. The hash is remembered until the address
+  // changes.
+  uint32_t getAddressHash() const {
+    if (!addressHashValid_) {
+      addressHash_ = hashAddress(getAddress(), addressLen_);
+      addressHashValid_ = true;
+    }
+    return addressHash_;
+  }
+
+  // Returns the FNV-1a hash of the given string. This can be evaluated at
+  // compile time; see also the OSC_ADDR macro.
+  static constexpr uint32_t hashAddress(const char *s) {
+    return fnv1a(s, kFnvOffsetBasis);
+  }
+
+  // Returns the FNV-1a hash of the first len characters of the given
+  // string.
+  static uint32_t hashAddress(const char *s, int len);
+
   // Returns the current argument count.
   int getArgCount() const {
     if (tagsLen_ == 0) {
@@ -208,7 +286,8 @@ class LiteOSCParser {
 
   // Checks if the argument at the given index is a boolean.
   bool isBoolean(int index) const {
-    return isTag(index, 'T') || isTag(index, 'F');
+    return (0 <= index && index < tagsLen_ - 1) &&
+           (tagInfo(buf_[tagsIndex_ + index + 1]) & kTagBoolean) != 0;
   }
 
   // Checks if the argument at the given index is a null.
@@ -246,7 +325,7 @@ class LiteOSCParser {
   bool getIfFloat(int index, float *v) const;
 
   // Gets a pointer to the string stored at the given index. This returns
-  // a pointer into the internal buffer, or nullptr if the index is out
+  // a pointer into the message buffer, or nullptr if the index is out
   // of range or if the argument is the wrong type.
   const char *getString(int index) const;
 
@@ -255,7 +334,7 @@ class LiteOSCParser {
   int getBlobLength(int index) const;
 
   // Gets a pointer to the stored stored at the given index. This returns
-  // a pointer into the internal buffer, or nullptr if the index if out
+  // a pointer into the message buffer, or nullptr if the index if out
   // of range or if the argument is the wrong type. See getBlobLength
   // to get the blob size.
   const uint8_t *getBlob(int index) const;
@@ -329,34 +408,84 @@ class LiteOSCParser {
   // calling code, and a second time by `getBoolean`.
   bool getIfBoolean(int index, bool *v) const;
 
- private:
-  // Ensures that we have enough buffer capacity. This returns whether
-  // we do, allocating if necessary. If there isn't enough space then
-  // the memory error condition will be set to 'true'.
-  //
-  // This does not ensure size is the next multiple of 4.
-  bool ensureCapacity(int size);
+ protected:
+  // Type tag descriptor bits. Each tag is described by one byte. The low
+  // bits hold the data size for fixed-size types; variable-length types
+  // have a zero size and one of the kind bits set instead.
+  static constexpr uint8_t kTagSizeMask = 0x0f;
+  static constexpr uint8_t kTagString = 0x10;  // OSC-string
+  static constexpr uint8_t kTagBlob = 0x20;  // OSC-blob
+  static constexpr uint8_t kTagBoolean = 0x40;  // 'T' or 'F'
+  static constexpr uint8_t kTagValid = 0x80;
+
+  // Describes one type tag. This is used to build kTagTable at compile
+  // time; use tagInfo() at runtime.
+  static constexpr uint8_t describeTag(int tag) {
+    return (tag == 'i' || tag == 'f' || tag == 'c' ||  // int32, float32, char
+            tag == 'r' || tag == 'm')  // RGBA, MIDI
+               ? kTagValid | 4
+           : (tag == 'h' || tag == 't' || tag == 'd')  // int64, time, float64
+               ? kTagValid | 8
+           : (tag == 's' || tag == 'S')  // OSC-string, symbol
+               ? kTagValid | kTagString
+           : (tag == 'b')  // OSC-blob
+               ? kTagValid | kTagBlob
+           : (tag == 'T' || tag == 'F')  // True, False
+               ? kTagValid | kTagBoolean
+           : (tag == 'N' || tag == 'I' ||  // Nil, Infinitum
+              tag == '[' || tag == ']')  // Array begin and end
+               ? kTagValid
+               : 0;
+  }
+
+  // Gets the descriptor for the given tag.
+  static uint8_t tagInfo(uint8_t tag) {
+#if defined(__AVR__)
+    return pgm_read_byte(&kTagTable[tag]);
+#else
+    return kTagTable[tag];
+#endif
+  }
+
+  // Descriptors for all 256 possible tags. On AVR, this is in PROGMEM.
+  static const uint8_t kTagTable[256];
+
+  // Releases the argument index array and returns this view to the empty
+  // state, as if it had been created with dynamic allocation.
+  void release();
 
   // Ensures that we have enough capacity for the argument indexes. This
   // returns whether we do, allocating if necessary. If there isn't enough
   // space then the memory error condition will be set to 'true'.
+  //
+  // A dynamic array grows by half again each time it's too small.
   bool ensureArgIndexesCapacity(int size);
 
+  // Reallocates the argument index array to the given capacity. This
+  // returns whether successful, and leaves the array alone if not.
+  bool reallocArgIndexes(int capacity);
+
+  // Records where the segments of the given address start. addressLen_
+  // must already be set.
+  void indexSegments(const char *addr);
+
+  static constexpr uint32_t kFnvOffsetBasis = 2166136261u;
+  static constexpr uint32_t kFnvPrime = 16777619u;
+
+  // Hashes the rest of the string, starting with the hash so far. This
+  // is recursive so that it can be constexpr in C++11.
+  static constexpr uint32_t fnv1a(const char *s, uint32_t h) {
+    return (*s == '\0')
+               ? h
+               : fnv1a(s + 1, (h ^ static_cast<uint8_t>(*s)) * kFnvPrime);
+  }
+
   // Aligns the given number to a multiple of 4.
   static int align(int n) {
     return ((n + 3) >> 2) << 2;
     // return off + ((4 - (off & 0x03)) & 0x03);
   }
 
-  // Adds one argument having the specified size to the buffer. Things
-  // are shifted around appropriately. This returns whether the addition
-  // was a success. As well, bufSize_ will be set to the correct total size.
-  //
-  // argSize is not expected to be a multiple of 4, but it is sized
-  // internally so that it is. Additionally, any extra allocated bytes
-  // are set to zero.
-  bool addArg(char tag, int argSize);
-
   // Parses a string starting at 'off' and returns the index just past
   // the NULL terminator. This will return a negative value if the end
   // of the string could not be found.
@@ -367,6 +496,31 @@ class LiteOSCParser {
   // if an error is encountered.
   int parseArgs(const uint8_t *buf, int off, int len);
 
+  // Checks the type tags and that there's enough data for the arguments
+  // starting at 'off', without looking at the data. This returns the
+  // message size if all the arguments are fixed-size, 'len' if there are
+  // variable-length arguments, or a negative value if there's an error.
+  int checkArgs(const uint8_t *buf, int off, int len);
+
+  // Skips over the string or blob starting at 'off' and returns the
+  // aligned index just past it, or a negative value if it's malformed.
+  static int skipVariableArg(const uint8_t *buf, int off, int len,
+                             uint8_t info);
+
+  // Gets a pointer to the data for the argument at the given index, or
+  // nullptr if its offset can't be found. The index must be in range.
+  const uint8_t *argData(int index) const {
+    if (index < argsResolved_) {
+      return &buf_[argIndexes_[index]];
+    }
+    return resolveArgs(index);
+  }
+
+  // Finds the argument offsets up to and including the given index and
+  // returns a pointer to the data for that argument. This returns nullptr
+  // if an argument is malformed.
+  const uint8_t *resolveArgs(int index) const;
+
   // Checks if the index is in range and the tag matches.
   bool isTag(int index, char tag) const {
     return (0 <= index && index < tagsLen_ - 1) &&
@@ -381,36 +535,20 @@ class LiteOSCParser {
            uint32_t{buf[3]};
   }
 
-  // Stores a big-endian-encoded uint32 into the given buffer.
-  static void setUint(uint8_t *buf, uint32_t i) {
-    buf[0] = i >> 24;
-    buf[1] = i >> 16;
-    buf[2] = i >> 8;
-    buf[3] = i;
-  }
-
   // Gets a big-endian-encoded uint64 from the given buffer.
   static uint64_t getUlong(const uint8_t *buf) {
     return (uint64_t{getUint(buf)} << 32) | uint64_t{getUint(buf + 4)};
   }
 
-  // Stores a big-endian-encoded uint64 into the given buffer.
-  static void setUlong(uint8_t *buf, uint64_t h) {
-    setUint(buf, h >> 32);
-    setUint(buf + 4, h);
-  }
-
   // Similar to strcmp, this returns whether the two strings match, but
   // if they do not match, then loc is set to the location of the first
   // mismatch.
   // Named in honour of the naming of yore.
   static bool strcmploc(const char *s1, const char *s2, int *loc);
 
-  // Buffer for holding the message
-  uint8_t *buf_;
+  // The message
+  const uint8_t *buf_;
   int bufSize_;  // Invariant: bufSize_ % 4 == 0
-  int bufCapacity_;
-  bool dynamicBuf_;
   bool memoryErr_;
 
   // All the parts
@@ -423,92 +561,1371 @@ class LiteOSCParser {
   int *argIndexes_;
   int argIndexesCapacity_;
   bool dynamicArgIndexes_;
+
+  // Lazy argument offsets. Only the first argsResolved_ entries of
+  // argIndexes_ are valid, and argsEnd_ is the index just past the last
+  // one of those arguments.
+  bool lazyArgs_;
+  mutable int argsResolved_;
+  mutable int argsEnd_;
+
+  // Where the first segments start, just past each '/'
+  int segmentCount_;
+  int segments_[kMaxSegments];
+
+  // The address hash, valid only if addressHashValid_ is set
+  bool hashAddress_;
+  mutable uint32_t addressHash_;
+  mutable bool addressHashValid_;
+
+  // Where all the memory comes from, including LiteOSCParser's buffer
+  OSCAllocator *allocator_;
+  int reallocCount_;
 };
 
-// OSCBundle is a container for OSC messages and other OSC bundles.
-// The internal buffer can be either dynamically allocated or set to a
+// OSCBlobRef refers to blob data, for use with LiteOSCParser::build and
+// the related functions. The data isn't copied until the message is built.
+// A negative size is treated as zero.
+struct OSCBlobRef {
+  const uint8_t *data;
+  int size;
+};
+
+// OSCTimetag holds a 64-bit OSC-timetag, for use with LiteOSCParser::build
+// and the related functions. It distinguishes a time from a 64-bit int.
+struct OSCTimetag {
+  uint64_t time;
+};
+
+// OSCTypeTag maps a C++ argument type to its OSC type tag. Only these types
+// are supported by LiteOSCParser::build and the related functions; using
+// any other type is a compile error.
+//
+// Integers, signed or unsigned, that are 32 bits or smaller are sent as 'i'
+// and 64-bit integers as 'h'; unsigned values keep their bits, so, for
+// example, a uint32_t above INT32_MAX is read back as a negative int32_t.
+// A plain char is sent as 'c'; use int8_t or uint8_t for small integers.
+// A double is sent as 'd', unless it's only 4 bytes, in which case it's
+// sent as 'f'. A bool's tag depends on its value; 'T' is just a
+// placeholder.
+template <typename T>
+struct OSCTypeTag;
+template <>
+struct OSCTypeTag<char> {
+  static constexpr char value = 'c';
+};
+template <>
+struct OSCTypeTag<signed char> {
+  static constexpr char value = 'i';
+};
+template <>
+struct OSCTypeTag<unsigned char> {
+  static constexpr char value = 'i';
+};
+template <>
+struct OSCTypeTag<short> {
+  static constexpr char value = 'i';
+};
+template <>
+struct OSCTypeTag<unsigned short> {
+  static constexpr char value = 'i';
+};
+template <>
+struct OSCTypeTag<int> {
+  static constexpr char value = (sizeof(int) == 8) ? 'h' : 'i';
+};
+template <>
+struct OSCTypeTag<unsigned int> {
+  static constexpr char value = (sizeof(unsigned int) == 8) ? 'h' : 'i';
+};
+template <>
+struct OSCTypeTag<long> {
+  static constexpr char value = (sizeof(long) == 8) ? 'h' : 'i';
+};
+template <>
+struct OSCTypeTag<unsigned long> {
+  static constexpr char value = (sizeof(unsigned long) == 8) ? 'h' : 'i';
+};
+template <>
+struct OSCTypeTag<long long> {
+  static constexpr char value = 'h';
+};
+template <>
+struct OSCTypeTag<unsigned long long> {
+  static constexpr char value = 'h';
+};
+template <>
+struct OSCTypeTag<float> {
+  static constexpr char value = 'f';
+};
+template <>
+struct OSCTypeTag<double> {
+  static constexpr char value = (sizeof(double) == 8) ? 'd' : 'f';
+};
+template <>
+struct OSCTypeTag<bool> {
+  static constexpr char value = 'T';
+};
+template <>
+struct OSCTypeTag<const char *> {
+  static constexpr char value = 's';
+};
+template <>
+struct OSCTypeTag<char *> {
+  static constexpr char value = 's';
+};
+template <>
+struct OSCTypeTag<OSCBlobRef> {
+  static constexpr char value = 'b';
+};
+template <>
+struct OSCTypeTag<OSCTimetag> {
+  static constexpr char value = 't';
+};
+
+// OSCTagString holds a complete, NULL-terminated type tag string, built at
+// compile time from the given tags.
+template <char... Tags>
+struct OSCTagString {
+  static constexpr char value[sizeof...(Tags) + 2]{',', Tags..., '\0'};
+};
+template <char... Tags>
+constexpr char OSCTagString<Tags...>::value[sizeof...(Tags) + 2];
+
+// LiteOSCParser parses and constructs OSC messages. The internal buffer
+// and argument list can be either dynamically allocated or set to a
 // specific size. Any functions that add to, initialize, or change the
-// bundle return whether they were successful. One of the possible
+// message return whether they were successful. One of the possible
 // reasons for failure is that there's not enough space in one of the
 // internal buffers, and more cannot be allocated. The isMemoryError()
 // function can be used to determine this case.
-class OSCBundle {
+//
+// One strategy when creating a message would be to add everything needed
+// and then check for a memory error afterwards, instead of after every
+// addition.
+//
+// Some of the functions return a pointer to a spot in the internal buffer.
+// Try not to mismanage those. :)
+//
+// Unlike OSCMessageView, parsing copies the message into the internal
+// buffer. The view is a private base so that nothing can parse, move, or
+// swap a view into one of these, which would leave it pointing at someone
+// else's data. All the getters and matching functions are available
+// here, and view() returns the message for anything that takes an
+// OSCMessageView.
+class LiteOSCParser : private OSCMessageView {
  public:
-  // Creates a new OSCBundle. The bundle time and maximum buffer size
-  // are given. If the maximum buffer size is positive and less than 16,
-  // then it will be set to 16. If it is non-positive, however, then the
-  // buffer will be dynamically allocated as needed. It should be a
-  // multiple of four.
-  OSCBundle(int bufCapacity);
+  using OSCMessageView::kMaxSegments;
+  // Creates a new OSC parser. The maximum buffer size and argument count
+  // are given. If the buffer size is non-positive then the buffer will be
+  // dynamically allocated as needed. The size should be a multiple of four.
+  //
+  // Similarly, if the maximum argument count, maxArgCount, is non-positive,
+  // then the internal array will be dynamically allocated as needed.
+  // Otherwise, the maxmimum number of arguments in a message will be
+  // limited to that count.
+  //
+  // The buffer size, bufSize, is given in bytes, and the maximum argument
+  // count, maxArgCount, is given in ints, i.e. maxArgCount*sizeof(int).
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  LiteOSCParser(int bufSize, int maxArgCount,
+                OSCAllocator *allocator = nullptr);
 
-  // Creates a new OSCBundle that has a dynamic buffer.
-  OSCBundle() : OSCBundle(0) {}
+  // Initializes a new OSC parser having dynamic buffer and argument
+  // allocation.
+  LiteOSCParser() : LiteOSCParser(0, 0) {}
 
   // Not copyable
-  OSCBundle(const OSCBundle &) = delete;
-  OSCBundle &operator=(const OSCBundle &) = delete;
+  LiteOSCParser(const LiteOSCParser &) = delete;
+  LiteOSCParser &operator=(const LiteOSCParser &) = delete;
 
-  ~OSCBundle();
+  // Movable. The buffers and their fixed or dynamic settings, along with
+  // the allocator, go with the message, so no message bytes are copied.
+  // The moved-from parser is left empty, with dynamic allocation.
+  LiteOSCParser(LiteOSCParser &&other) noexcept;
+  LiteOSCParser &operator=(LiteOSCParser &&other) noexcept;
 
-  // Resets the contents and uses the given time for the bundle.
-  // This also resets the memory error condition.
-  //
-  // This must be called at least once before messages or bundles can
-  // be added.
-  bool init(uint64_t time);
+  // Swaps the contents of this parser with another.
+  void swap(LiteOSCParser &other) noexcept;
 
-  // Returns the total size of the bundle.
-  int size() const {
-    return bufSize_;
-  }
+  ~LiteOSCParser();
 
-  // Gets a pointer to the internal buffer, for sending the data elsewhere.
-  // See size() to retrieve the size. Play nice with this pointer.
-  const uint8_t *buf() const {
-    return buf_;
+  // Returns the message as a read-only view, for passing to anything that
+  // takes an OSCMessageView. The view is valid until this parser changes.
+  const OSCMessageView &view() const {
+    return *this;
   }
 
-  // Returns whether an insufficient buffer size is preventing the latest
-  // content from being added.
-  bool isMemoryError() const {
-    return memoryErr_;
-  }
+  // The getters and matching functions, from OSCMessageView
+  using OSCMessageView::getMessageSize;
+  using OSCMessageView::getMessageBuf;
+  using OSCMessageView::getArgCapacity;
+  using OSCMessageView::getReallocCount;
+  using OSCMessageView::isMemoryError;
+  using OSCMessageView::setLazyArgs;
+  using OSCMessageView::isLazyArgs;
+  using OSCMessageView::setHashAddress;
+  using OSCMessageView::isHashAddress;
+  using OSCMessageView::fullMatch;
+  using OSCMessageView::match;
+  using OSCMessageView::getAddress;
+  using OSCMessageView::getSegmentCount;
+  using OSCMessageView::getSegment;
+  using OSCMessageView::matchSegment;
+  using OSCMessageView::getAddressHash;
+  using OSCMessageView::hashAddress;
+  using OSCMessageView::getArgCount;
+  using OSCMessageView::getTag;
+  using OSCMessageView::isInt;
+  using OSCMessageView::isFloat;
+  using OSCMessageView::isString;
+  using OSCMessageView::isBlob;
+  using OSCMessageView::isLong;
+  using OSCMessageView::isTime;
+  using OSCMessageView::isDouble;
+  using OSCMessageView::isChar;
+  using OSCMessageView::isBoolean;
+  using OSCMessageView::isNull;
+  using OSCMessageView::isImpulse;
+  using OSCMessageView::getInt;
+  using OSCMessageView::getIfInt;
+  using OSCMessageView::getFloat;
+  using OSCMessageView::getIfFloat;
+  using OSCMessageView::getString;
+  using OSCMessageView::getBlobLength;
+  using OSCMessageView::getBlob;
+  using OSCMessageView::getLong;
+  using OSCMessageView::getIfLong;
+  using OSCMessageView::getTime;
+  using OSCMessageView::getIfTime;
+  using OSCMessageView::getDouble;
+  using OSCMessageView::getIfDouble;
+  using OSCMessageView::getChar;
+  using OSCMessageView::getIfChar;
+  using OSCMessageView::getBoolean;
+  using OSCMessageView::getIfBoolean;
 
-  // Adds an OSC message to this bundle. This will return false if
-  // the message could not be added, either due to init not being
-  // called at least once or insufficient memory.
-  bool addMessage(const LiteOSCParser &osc);
+  // ------------------------------------------------------------------------
+  //  Memory
+  // ------------------------------------------------------------------------
 
-  // Adds another OSC bundle to this bundle. This will return false if
-  // the message could not be added, either due to init not being called
-  // at least once or insufficient memory.
-  bool addBundle(const OSCBundle &bundle);
+  // Returns the current capacity of the message buffer, in bytes.
+  int getCapacity() const {
+    return bufCapacity_;
+  }
 
-  // Parses the given buffer and returns whether it is a valid bundle. This
-  // recursively looks into sub-bundles. If a bundle element is an OSC message
-  // then a rudimentary check for starting with a '/' character is performed.
-  static bool parse(const uint8_t *buf, int32_t len);
+  // Makes sure there's room for a message having the given size and
+  // argument count, so that building or parsing one doesn't need to
+  // reallocate. This returns whether there's enough room, which, for a
+  // fixed-size buffer or array, is only whether it's already big enough.
+  bool reserve(int size, int argCount);
 
- private:
+  // Releases any unused capacity in the dynamically allocated buffers.
+  // Fixed-size buffers aren't changed.
+  void shrinkToFit();
+
+  // ------------------------------------------------------------------------
+  //  Creating
+  // ------------------------------------------------------------------------
+
+  // Initializes the message with a new address and no arguments. This
+  // returns whether the initialization was successful. This will be
+  // unsuccessful if the address does not start with a '/' or if there
+  // isn't enough space in the internal buffer. The second condition can
+  // be checked with a call to isMemoryError().
+  bool init(const char *address);
+
+  // Initializes the message with a new address and a declared set of
+  // type tags, for example ",iffsb". The whole type tag section is laid
+  // out here, so each following addXXX call only appends its data and
+  // nothing needs to be moved. The arguments must then be added in the
+  // declared order; adding one whose type doesn't match the next declared
+  // tag fails. A declared 'T' or 'F' accepts either boolean value, and
+  // 'N', 'I', '[', and ']' are filled in automatically because they have
+  // no data.
+  //
+  // The message isn't complete, and getMessageSize() doesn't cover all the
+  // declared arguments, until all of them have been added. getArgCount()
+  // returns the number added so far. Once they're all added, more
+  // arguments can be added as usual.
+  //
+  // This returns whether the initialization was successful. This will be
+  // unsuccessful if the address does not start with a '/', if the tags
+  // don't start with a ',' or contain an unknown tag or one that can't be
+  // added ('c', 'r', 'm', or 'S'), or if there isn't enough space in the
+  // internal buffers.
+  bool init(const char *address, const char *tags);
+
+  // Clears the message. Under the covers, this calls init with an
+  // empty string and then ignores the result.
+  void clear() {
+    init("");
+  }
+
+  // Adds a 32-bit int argument.
+  bool addInt(int32_t i);
+
+  // Adds a 32-bit float argument.
+  bool addFloat(float f);
+
+  // Adds a string.
+  bool addString(const char *s);
+
+  // Adds a blob having the given length.
+  bool addBlob(const uint8_t *b, int len);
+
+  // Adds a 64-bit long argument.
+  bool addLong(int64_t h);
+
+  // Adds a 64-bit time argument.
+  bool addTime(uint64_t t);
+
+  // Adds a 64-bit double argument.
+  //
+  // This will return `false` if the size of type `double` is not 8 bytes.
+  bool addDouble(double d);
+
+  // Adds a boolean.
+  bool addBoolean(bool b);
+
+  // ------------------------------------------------------------------------
+  //  Changing arguments in place
+  // ------------------------------------------------------------------------
+
+  // These replace the value of an existing argument without rebuilding the
+  // message, so a built message can be used as a template: build it once,
+  // and then change the values and resend it. Each returns whether the
+  // value was set, which will be `false` if the index is out of range or
+  // if the argument is a different type. The fixed-size setters only
+  // overwrite the argument's bytes.
+
+  // Sets the 32-bit int at the given index.
+  bool setInt(int index, int32_t i);
+
+  // Sets the 32-bit float at the given index.
+  bool setFloat(int index, float f);
+
+  // Sets the 64-bit long at the given index.
+  bool setLong(int index, int64_t h);
+
+  // Sets the 64-bit time at the given index.
+  bool setTime(int index, uint64_t t);
+
+  // Sets the 64-bit double at the given index.
+  //
+  // This will return `false` if the size of type `double` is not 8 bytes.
+  bool setDouble(int index, double d);
+
+  // Sets the boolean at the given index. This changes its type tag.
+  bool setBoolean(int index, bool b);
+
+  // Sets the string at the given index. If the padded size changes then
+  // all the following arguments are moved. The string must not point into
+  // this message. This may also fail if there isn't enough space in the
+  // internal buffer.
+  bool setString(int index, const char *s);
+
+  // Sets the blob at the given index. If the padded size changes then all
+  // the following arguments are moved. The data must not point into this
+  // message. This may also fail if there isn't enough space in the
+  // internal buffer.
+  bool setBlob(int index, const uint8_t *b, int len);
+
+  // ------------------------------------------------------------------------
+  //  Building in one step
+  // ------------------------------------------------------------------------
+
+  // Replaces the message with one having the given address and arguments,
+  // for example:
+  //
+  //   osc.build("/mixer/ch/3", int32_t{1}, 0.5f, "name", blobRef);
+  //
+  // The type tags are generated at compile time from the argument types;
+  // see OSCTypeTag for the supported types. The exact size is computed
+  // first, and then everything is written in one pass, so this is much
+  // cheaper than init() followed by several addXXX calls.
+  //
+  // This returns whether the message was built. It will be unsuccessful
+  // if the address does not start with a '/' or if there isn't enough
+  // space in the internal buffers.
+  template <typename... Args>
+  bool build(const char *address, Args... args);
+
+  // Returns the encoded size of a message having the given address and
+  // arguments, without building it. This is useful for sizing buffers.
+  // This returns zero if the address does not start with a '/'.
+  template <typename... Args>
+  static int messageSize(const char *address, Args... args);
+
+  // Encodes a message having the given address and arguments directly into
+  // the given buffer, without needing a LiteOSCParser. This returns the
+  // size of the message, or zero if the address does not start with a '/'
+  // or if the message doesn't fit into bufSize bytes.
+  template <typename... Args>
+  static int buildMessage(uint8_t *buf, int bufSize, const char *address,
+                          Args... args);
+
+  // ------------------------------------------------------------------------
+  //  Parsing
+  // ------------------------------------------------------------------------
+
+  // Parses the given buffer and returns whether the message is valid. The
+  // message is copied into the internal buffer, so the given buffer is
+  // free to be reused after this returns.
+  //
+  // If this returns 'false' then isMemoryError() can be used to determine
+  // whether the failure was due to not enough space in the internal buffer.
+  bool parse(const uint8_t *buf, int len);
+
+ private:
+  // Ensures that we have enough buffer capacity. This returns whether
+  // we do, allocating if necessary. If there isn't enough space then
+  // the memory error condition will be set to 'true'.
+  //
+  // This does not ensure size is the next multiple of 4. A dynamic buffer
+  // grows by half again each time it's too small.
+  bool ensureCapacity(int size);
+
+  // Reallocates the buffer to the given capacity. This returns whether
+  // successful, and leaves the buffer alone if not.
+  bool reallocBuf(int capacity);
+
+  // Releases the buffer and returns the parts specific to this class to
+  // the empty state.
+  void releaseBuf();
+
+  // Adds one argument having the specified size to the buffer. Things
+  // are shifted around appropriately. This returns whether the addition
+  // was a success. As well, bufSize_ will be set to the correct total size.
+  //
+  // argSize is not expected to be a multiple of 4, but it is sized
+  // internally so that it is. Additionally, any extra allocated bytes
+  // are set to zero.
+  bool addArg(char tag, int argSize);
+
+  // Adds one fixed-size argument. The size comes from the tag table.
+  bool addArg(char tag);
+
+  // Finds the offsets of all the arguments, if they haven't been found
+  // yet, and sets bufSize_ to the end of the last one. This only does
+  // something after a lazy parse. This returns whether all the arguments
+  // could be found.
+  bool resolveAllArgs();
+
+  // Gets a writable pointer to the data for the argument at the given
+  // index, or nullptr if it can't be found. The index must be in range.
+  uint8_t *ownArgData(int index) {
+    const uint8_t *data = argData(index);
+    if (data == nullptr) {
+      return nullptr;
+    }
+    return &ownBuf_[data - buf_];
+  }
+
+  // Changes the padded size of the variable-length argument at the given
+  // index, moving everything after it, and returns a pointer to its data.
+  // This returns nullptr if there isn't enough memory.
+  uint8_t *resizeArg(int index, int oldSize, int newSize);
+
+  // Adds one argument for the next declared tag. This is used by addArg
+  // when there are declared tags still to be filled.
+  bool addDeclaredArg(char tag, int argSize);
+
+  // Records all the declared, data-less, non-boolean arguments at the
+  // current position. These are 'N', 'I', '[', and ']'.
+  void skipDeclaredEmptyArgs();
+
+  // Stores a big-endian-encoded uint32 into the given buffer.
+  static void setUint(uint8_t *buf, uint32_t i) {
+    buf[0] = i >> 24;
+    buf[1] = i >> 16;
+    buf[2] = i >> 8;
+    buf[3] = i;
+  }
+
+  // Stores a big-endian-encoded uint64 into the given buffer.
+  static void setUlong(uint8_t *buf, uint64_t h) {
+    setUint(buf, h >> 32);
+    setUint(buf + 4, h);
+  }
+
+  // Returns the size of the type tag section for the given number of
+  // arguments. There's no section if there are no arguments.
+  static constexpr int tagsSize(int argCount) {
+    return (argCount == 0) ? 0 : ((argCount + 2 + 3) >> 2) << 2;
+  }
+
+  // Encoded argument sizes, including any padding.
+  static int argSize(char) { return 4; }
+  static int argSize(signed char) { return 4; }
+  static int argSize(unsigned char) { return 4; }
+  static int argSize(short) { return 4; }
+  static int argSize(unsigned short) { return 4; }
+  static int argSize(int) { return (sizeof(int) == 8) ? 8 : 4; }
+  static int argSize(unsigned int) {
+    return (sizeof(unsigned int) == 8) ? 8 : 4;
+  }
+  static int argSize(long) { return (sizeof(long) == 8) ? 8 : 4; }
+  static int argSize(unsigned long) {
+    return (sizeof(unsigned long) == 8) ? 8 : 4;
+  }
+  static int argSize(long long) { return 8; }
+  static int argSize(unsigned long long) { return 8; }
+  static int argSize(float) { return 4; }
+  static int argSize(double) { return (sizeof(double) == 8) ? 8 : 4; }
+  static int argSize(bool) { return 0; }
+  static int argSize(const char *s) { return align(strlen(s) + 1); }
+  static int argSize(OSCBlobRef b) {
+    return (b.size <= 0) ? 4 : align(b.size + 4);
+  }
+  static int argSize(OSCTimetag) { return 8; }
+
+  static int argsSize() { return 0; }
+  template <typename T, typename... Rest>
+  static int argsSize(T arg, Rest... rest) {
+    return argSize(arg) + argsSize(rest...);
+  }
+
+  // Writes an integer as either 4 or 8 bytes and returns the position just
+  // past it. Signed values arrive here sign-extended, so the low 4 bytes
+  // are their 32-bit two's complement form.
+  static uint8_t *writeInteger(uint8_t *p, uint64_t v, int size) {
+    if (size == 8) {
+      setUlong(p, v);
+    } else {
+      setUint(p, v);
+    }
+    return p + size;
+  }
+
+  // Writes one argument's data at 'p' and returns the position just past
+  // it. Booleans change their tag instead.
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, char v) {
+    return writeInteger(p, static_cast<unsigned char>(v), 4);
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, signed char v) {
+    return writeInteger(p, v, 4);
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, unsigned char v) {
+    return writeInteger(p, v, 4);
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, short v) {
+    return writeInteger(p, v, 4);
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, unsigned short v) {
+    return writeInteger(p, v, 4);
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, int v) {
+    return writeInteger(p, v, argSize(v));
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, unsigned int v) {
+    return writeInteger(p, v, argSize(v));
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, long v) {
+    return writeInteger(p, v, argSize(v));
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, unsigned long v) {
+    return writeInteger(p, v, argSize(v));
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, long long v) {
+    return writeInteger(p, v, 8);
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, unsigned long long v) {
+    return writeInteger(p, v, 8);
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, float v) {
+    static_assert(sizeof(float) == 4, "sizeof(float) == 4");
+    uint32_t u;
+    memcpy(&u, &v, 4);
+    setUint(p, u);
+    return p + 4;
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *tag, double v) {
+    if (sizeof(double) != 8) {
+      return writeArg(p, tag, static_cast<float>(v));
+    }
+    uint64_t u;
+    memcpy(&u, &v, 8);
+    setUlong(p, u);
+    return p + 8;
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *tag, bool v) {
+    *tag = v ? 'T' : 'F';
+    return p;
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, const char *s) {
+    int len = strlen(s) + 1;
+    int size = align(len);
+    memcpy(p, s, len);
+    memset(p + len, 0, size - len);
+    return p + size;
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, OSCBlobRef b) {
+    int len = (b.size < 0) ? 0 : b.size;
+    int size = align(len + 4);
+    setUint(p, len);
+    if (len > 0) {
+      memcpy(p + 4, b.data, len);
+    }
+    memset(p + 4 + len, 0, size - (len + 4));
+    return p + size;
+  }
+  static uint8_t *writeArg(uint8_t *p, uint8_t *, OSCTimetag t) {
+    setUlong(p, t.time);
+    return p + 8;
+  }
+
+  // Writes all the argument data, starting at 'p', recording each offset
+  // from 'start' in 'indexes' if it isn't nullptr.
+  static void writeArgs(const uint8_t *, uint8_t *, uint8_t *, int *) {}
+  template <typename T, typename... Rest>
+  static void writeArgs(const uint8_t *start, uint8_t *tag, uint8_t *p,
+                        int *indexes, T arg, Rest... rest) {
+    if (indexes != nullptr) {
+      *(indexes++) = p - start;
+    }
+    p = writeArg(p, tag, arg);
+    writeArgs(start, tag + 1, p, indexes, rest...);
+  }
+
+  // Writes a complete message into 'buf', which must be large enough, and
+  // records the argument offsets in 'indexes' if it isn't nullptr. This
+  // returns the index of the type tags.
+  template <typename... Args>
+  static int writeMessage(uint8_t *buf, const char *address, int addrLen,
+                          int *indexes, Args... args);
+
+  // Buffer for holding the message. The view's buf_ always points here.
+  uint8_t *ownBuf_;
+  int bufCapacity_;
+  bool dynamicBuf_;
+
+  // Length of the tags declared with init(address, tags), including the
+  // ','. While tagsLen_ is less than this, the remaining declared tags are
+  // in the buffer after the filled ones, but the NULL isn't.
+  int declaredTagsLen_;
+};
+
+// --------------------------------------------------------------------------
+//  LiteOSCParser template implementations
+// --------------------------------------------------------------------------
+
+template <typename... Args>
+int LiteOSCParser::writeMessage(uint8_t *buf, const char *address,
+                                int addrLen, int *indexes, Args... args) {
+  constexpr int kArgCount = sizeof...(Args);
+  constexpr int kTagsSize = tagsSize(kArgCount);
+
+  int tagsIndex = align(addrLen + 1);
+  memcpy(buf, address, addrLen);
+  memset(&buf[addrLen], 0, tagsIndex - addrLen);
+  if (kArgCount > 0) {
+    memcpy(&buf[tagsIndex],
+           OSCTagString<OSCTypeTag<Args>::value...>::value, kArgCount + 1);
+    memset(&buf[tagsIndex + kArgCount + 1], 0, kTagsSize - (kArgCount + 1));
+  }
+  writeArgs(buf, &buf[tagsIndex + 1], &buf[tagsIndex + kTagsSize], indexes,
+            args...);
+  return tagsIndex;
+}
+
+template <typename... Args>
+int LiteOSCParser::messageSize(const char *address, Args... args) {
+  if (address[0] != '/') {
+    return 0;
+  }
+  return align(strlen(address) + 1) + tagsSize(sizeof...(Args)) +
+         argsSize(args...);
+}
+
+template <typename... Args>
+int LiteOSCParser::buildMessage(uint8_t *buf, int bufSize,
+                                const char *address, Args... args) {
+  int size = messageSize(address, args...);
+  if (size <= 0 || size > bufSize) {
+    return 0;
+  }
+  writeMessage(buf, address, strlen(address), nullptr, args...);
+  return size;
+}
+
+template <typename... Args>
+bool LiteOSCParser::build(const char *address, Args... args) {
+  constexpr int kArgCount = sizeof...(Args);
+
+  memoryErr_ = false;
+  addressLen_ = 0;
+  tagsLen_ = 0;
+  bufSize_ = 0;
+  argsResolved_ = 0;
+  addressHashValid_ = false;
+  declaredTagsLen_ = 0;
+
+  int size = messageSize(address, args...);
+  if (size <= 0) {
+    return false;
+  }
+  if (!ensureCapacity(size) || !ensureArgIndexesCapacity(kArgCount)) {
+    return false;
+  }
+
+  int addrLen = strlen(address);
+  tagsIndex_ = writeMessage(ownBuf_, address, addrLen, argIndexes_, args...);
+  addressLen_ = addrLen;
+  indexSegments(address);
+  tagsLen_ = (kArgCount == 0) ? 0 : kArgCount + 1;
+  dataIndex_ = tagsIndex_ + tagsSize(kArgCount);
+  bufSize_ = size;
+  argsResolved_ = kArgCount;
+  argsEnd_ = size;
+  return true;
+}
+
+// OSCBundle is a container for OSC messages and other OSC bundles.
+// The internal buffer can be either dynamically allocated or set to a
+// specific size. Any functions that add to, initialize, or change the
+// bundle return whether they were successful. One of the possible
+// reasons for failure is that there's not enough space in one of the
+// internal buffers, and more cannot be allocated. The isMemoryError()
+// function can be used to determine this case.
+//
+// Nested bundles and messages can be written directly into the buffer,
+// without building them separately and copying them in. For example:
+//
+//   bundle.init(time);
+//   bundle.beginBundle(later);
+//   bundle.addMessage("/synth/1/gain", 0.5f);
+//   bundle.endBundle();
+class OSCBundle {
+ public:
+  // The maximum number of bundles that can be open at once with
+  // beginBundle().
+  static constexpr int kMaxOpenBundles = 8;
+
+  // Creates a new OSCBundle. The bundle time and maximum buffer size
+  // are given. If the maximum buffer size is positive and less than 16,
+  // then it will be set to 16. If it is non-positive, however, then the
+  // buffer will be dynamically allocated as needed. It should be a
+  // multiple of four.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCBundle(int bufCapacity, OSCAllocator *allocator = nullptr);
+
+  // Creates a new OSCBundle that has a dynamic buffer.
+  OSCBundle() : OSCBundle(0) {}
+
+  // Not copyable
+  OSCBundle(const OSCBundle &) = delete;
+  OSCBundle &operator=(const OSCBundle &) = delete;
+
+  // Movable. The buffer and its fixed or dynamic setting, along with the
+  // allocator, go with the bundle. The moved-from bundle is left empty,
+  // with a dynamic buffer, and needs init to be called before reuse.
+  OSCBundle(OSCBundle &&other) noexcept;
+  OSCBundle &operator=(OSCBundle &&other) noexcept;
+
+  // Swaps the contents of this bundle with another.
+  void swap(OSCBundle &other) noexcept;
+
+  ~OSCBundle();
+
+  // Resets the contents and uses the given time for the bundle.
+  // This also resets the memory error condition.
+  //
+  // This must be called at least once before messages or bundles can
+  // be added.
+  bool init(uint64_t time);
+
+  // Returns the total size of the bundle.
+  int size() const {
+    return bufSize_;
+  }
+
+  // Gets a pointer to the internal buffer, for sending the data elsewhere.
+  // See size() to retrieve the size. Play nice with this pointer.
+  const uint8_t *buf() const {
+    return buf_;
+  }
+
+  // Returns whether an insufficient buffer size is preventing the latest
+  // content from being added.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Returns the current capacity of the buffer, in bytes.
+  int capacity() const {
+    return bufCapacity_;
+  }
+
+  // Returns the number of times the buffer has been reallocated. This is
+  // useful for choosing a fixed size from real traffic.
+  int reallocCount() const {
+    return reallocCount_;
+  }
+
+  // Makes sure there's room for a bundle having the given size, so that
+  // adding to it doesn't need to reallocate. This returns whether there's
+  // enough room, which, for a fixed-size buffer, is only whether it's
+  // already big enough.
+  bool reserve(int size);
+
+  // Releases any unused capacity in a dynamically allocated buffer. A
+  // fixed-size buffer isn't changed.
+  void shrinkToFit();
+
+  // Adds an OSC message to this bundle. This will return false if
+  // the message could not be added, either due to init not being
+  // called at least once or insufficient memory.
+  //
+  // The message can be either a LiteOSCParser or an OSCMessageView.
+  bool addMessage(const OSCMessageView &osc);
+  bool addMessage(const LiteOSCParser &osc) {
+    return addMessage(osc.view());
+  }
+
+  // Adds another OSC bundle to this bundle. This will return false if
+  // the message could not be added, either due to init not being called
+  // at least once or insufficient memory.
+  bool addBundle(const OSCBundle &bundle);
+
+  // Encodes a message having the given address and arguments directly
+  // into this bundle, in the same way as LiteOSCParser::build. Each byte
+  // is written once, since the size is known up front. This will return
+  // false if the address does not start with a '/', init has not been
+  // called at least once, or there's insufficient memory.
+  template <typename... Args>
+  bool addMessage(const char *address, Args... args);
+
+  // Starts a nested bundle having the given time. Everything added until
+  // the matching endBundle() goes into the nested bundle. Its size is
+  // filled in when it's ended, so the contents aren't copied. This will
+  // return false if init has not been called at least once, if
+  // kMaxOpenBundles bundles are already open, or if there's insufficient
+  // memory.
+  //
+  // The buffer isn't a valid bundle while any nested bundles are open.
+  bool beginBundle(uint64_t time);
+
+  // Ends the most recently started nested bundle. This returns false if
+  // there isn't one.
+  bool endBundle();
+
+  // Returns the number of nested bundles started but not yet ended.
+  int getOpenBundleCount() const {
+    return openCount_;
+  }
+
+  // Parses the given buffer and returns whether it is a valid bundle. This
+  // looks into sub-bundles, nested up to OSCBundleValidator::kMaxDepth
+  // deep. If a bundle element is an OSC message then a rudimentary check
+  // for starting with a '/' character is performed. Use an
+  // OSCBundleValidator directly for other limits or to find out why a
+  // bundle isn't valid.
+  static bool parse(const uint8_t *buf, int32_t len);
+
+ private:
   // Adds content to the bundle. This returns false if init has not
   // been called at least once.
   bool add(const uint8_t *buf, int32_t size);
 
+  // Writes a big-endian element size at the given index.
+  void writeSize(int index, int32_t size) {
+    uint32_t u = static_cast<uint32_t>(size);
+    buf_[index] = u >> 24;
+    buf_[index + 1] = u >> 16;
+    buf_[index + 2] = u >> 8;
+    buf_[index + 3] = u;
+  }
+
+  // Writes the "#bundle" header and the given time at the given index.
+  void writeHeader(int index, uint64_t time);
+
   // Ensures that we have enough buffer capacity. This returns whether
   // we do, allocating if necessary. If there isn't enough space then
   // the memory error condition will be set to 'true'.
+  //
+  // A dynamic buffer grows by half again each time it's too small.
   bool ensureCapacity(int size);
 
+  // Reallocates the buffer to the given capacity. This returns whether
+  // successful, and leaves the buffer alone if not.
+  bool reallocBuf(int capacity);
+
+  // Releases the buffer and returns this bundle to the empty state, as if
+  // it had been created with a dynamic buffer.
+  void release();
+
   uint8_t *buf_;
   int bufSize_;
   int bufCapacity_;
   bool dynamicBuf_;
   bool memoryErr_;
+  OSCAllocator *allocator_;
+  int reallocCount_;
 
   bool isInitted_;
+
+  // Where the size of each open nested bundle goes
+  int openBundles_[kMaxOpenBundles];
+  int openCount_;
 };
 
+template <typename... Args>
+bool OSCBundle::addMessage(const char *address, Args... args) {
+  if (!isInitted_) {
+    return false;
+  }
+  int size = LiteOSCParser::messageSize(address, args...);
+  if (size <= 0) {
+    return false;
+  }
+  if (!ensureCapacity(bufSize_ + 4 + size)) {
+    return false;
+  }
+  writeSize(bufSize_, size);
+  LiteOSCParser::buildMessage(&buf_[bufSize_ + 4], size, address, args...);
+  bufSize_ += 4 + size;
+  return true;
+}
+
+class OSCBundleReader;
+
+// OSCBundleElement is one element of a received bundle, either a message
+// or another bundle. It points into the bundle's buffer; nothing is
+// copied.
+class OSCBundleElement {
+ public:
+  OSCBundleElement(const uint8_t *data, int size)
+      : data_(data), size_(size) {}
+
+  // Returns a pointer to the element's data, not including its size.
+  const uint8_t *data() const {
+    return data_;
+  }
+
+  // Returns the size of the element's data.
+  int size() const {
+    return size_;
+  }
+
+  // Returns whether the element starts like a bundle.
+  bool isBundle() const {
+    return size_ >= 16 && memcmp(data_, "#bundle", 8) == 0;
+  }
+
+  // Returns whether the element starts like a message.
+  bool isMessage() const {
+    return size_ > 0 && data_[0] == '/';
+  }
+
+  // Parses the element as a message into the given view, which then
+  // points into the bundle's buffer. This returns whether successful.
+  // To copy the element into a LiteOSCParser instead, use the parser's
+  // own parse() with data() and size().
+  bool getMessage(OSCMessageView *view) const {
+    return view->parse(data_, size_);
+  }
+
+  // Sets up the given reader to read the element as a bundle. This
+  // returns whether successful.
+  bool getBundle(OSCBundleReader *reader) const;
+
+ private:
+  const uint8_t *data_;
+  int size_;
+};
+
+// OSCBundleReader reads a received bundle in place, without copying or
+// allocating. It provides the time tag and a forward iterator over the
+// elements, each of which can then be parsed as a message view or read
+// with another OSCBundleReader, all pointing into the original buffer.
+// That buffer must remain valid and unchanged for as long as the reader
+// and anything read from it are used.
+//
+// For example:
+//
+//   OSCBundleReader reader;
+//   OSCMessageView view;
+//   if (reader.init(buf, len)) {
+//     for (OSCBundleElement e : reader) {
+//       if (e.getMessage(&view)) {
+//         // ...
+//       }
+//     }
+//   }
+class OSCBundleReader {
+ public:
+  // Iterates over the elements of a bundle. The element sizes have
+  // already been checked by init().
+  class Iterator {
+   public:
+    Iterator(const uint8_t *buf, int index) : buf_(buf), index_(index) {}
+
+    OSCBundleElement operator*() const {
+      return OSCBundleElement{&buf_[index_ + 4], elementSize()};
+    }
+
+    Iterator &operator++() {
+      index_ += 4 + elementSize();
+      return *this;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return index_ == other.index_;
+    }
+
+    bool operator!=(const Iterator &other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    int elementSize() const {
+      return static_cast<int>(
+          uint32_t{buf_[index_]} << 24 | uint32_t{buf_[index_ + 1]} << 16 |
+          uint32_t{buf_[index_ + 2]} << 8 | uint32_t{buf_[index_ + 3]});
+    }
+
+    const uint8_t *buf_;
+    int index_;
+  };
+
+  // Creates an empty reader. init() must be called before it can be used.
+  OSCBundleReader() : buf_(nullptr), size_(0), elementCount_(0) {}
+
+  // Sets up this reader for the given buffer and returns whether it holds
+  // a bundle. This checks the header and that the element sizes exactly
+  // fill the buffer, but doesn't look inside the elements; sub-bundles
+  // are checked when they're read. If this returns 'false' then the
+  // reader is empty.
+  bool init(const uint8_t *buf, int len);
+
+  // Returns whether this reader holds a bundle.
+  bool isValid() const {
+    return buf_ != nullptr;
+  }
+
+  // Returns the bundle's time tag, or zero if this reader is empty.
+  uint64_t getTime() const;
+
+  // Returns the number of elements.
+  int getElementCount() const {
+    return elementCount_;
+  }
+
+  // Returns a pointer to the bundle's buffer.
+  const uint8_t *buf() const {
+    return buf_;
+  }
+
+  // Returns the size of the bundle.
+  int size() const {
+    return size_;
+  }
+
+  Iterator begin() const {
+    return Iterator{buf_, (buf_ == nullptr) ? 0 : 16};
+  }
+
+  Iterator end() const {
+    return Iterator{buf_, size_};
+  }
+
+ private:
+  const uint8_t *buf_;
+  int size_;
+  int elementCount_;
+};
+
+inline bool OSCBundleElement::getBundle(OSCBundleReader *reader) const {
+  return reader->init(data_, size_);
+}
+
+// OSCBundleValidator checks that a received bundle is well-formed,
+// including all its nested bundles, in one pass and without recursing.
+// Nesting is tracked with a small fixed stack, so a sender can't use deep
+// nesting to exhaust the call stack. Both the depth and the total number
+// of elements can be limited. When validation fails, the reason and the
+// offset of the offending bytes are available.
+class OSCBundleValidator {
+ public:
+  // The deepest nesting that can be allowed, counting the outer bundle.
+  static constexpr int kMaxDepth = 32;
+
+  // Reasons for failing.
+  enum Error : uint8_t {
+    kNoError,
+    kBadLength,        // Too short or not a multiple of four
+    kNotBundle,        // Doesn't start with "#bundle"
+    kBadElementSize,   // Not positive, not a multiple of 4, or too large
+    kBadMessage,       // An element that doesn't start with '/'
+    kTooDeep,          // Bundles nested more than the maximum depth
+    kTooManyElements,  // More than the maximum number of elements
+  };
+
+  // Creates a validator that allows nesting up to maxDepth bundles deep,
+  // counting the outer one, and up to maxElements elements in total,
+  // counting those in nested bundles. The depth is limited to kMaxDepth,
+  // and a non-positive maxElements means no limit.
+  OSCBundleValidator(int maxDepth = 8, int maxElements = 0);
+
+  // Checks the given bundle and returns whether it's valid. As with
+  // OSCBundle::parse, a message is only checked for starting with a '/'.
+  bool validate(const uint8_t *buf, int len);
+
+  // Returns the reason the last validation failed, or kNoError.
+  Error getError() const {
+    return error_;
+  }
+
+  // Returns the offset of the bytes that caused the last validation to
+  // fail, or -1 if it didn't fail.
+  int getErrorOffset() const {
+    return errorOffset_;
+  }
+
+  // Returns the number of elements seen by the last validation,
+  // including those in nested bundles.
+  int getElementCount() const {
+    return elementCount_;
+  }
+
+ private:
+  // Records an error and returns 'false'.
+  bool fail(Error error, int offset) {
+    error_ = error;
+    errorOffset_ = offset;
+    return false;
+  }
+
+  int maxDepth_;
+  int maxElements_;
+
+  Error error_;
+  int errorOffset_;
+  int elementCount_;
+};
+
+// CompiledOSCPattern is an OSC 1.0 address pattern that has been
+// compiled once into a small instruction list, so that it can be
+// matched against many addresses quickly. Matching neither allocates nor
+// recurses. The supported syntax is:
+// * '?' matches any single character except '/'.
+// * '*' matches any run of characters, possibly empty, except '/'.
+// * "[...]" matches one character in the list, which may contain ranges
+//   such as "a-z". A leading '!' negates the list. A '-' at the start or
+//   end of the list is a literal '-'.
+// * "{foo,bar}" matches any one of the comma-separated strings.
+// * Everything else matches itself.
+//
+// Matching works in both directions. A pattern registered by the
+// receiver is matched against the address of a parsed message with
+// matches(msg). An incoming address that is itself a pattern is compiled
+// with compile(msg) and then matched against each concrete address with
+// matches(address).
+//
+// The instruction list has a fixed size, kMaxInstructions. Each run of
+// literal characters, '?', '*', or list takes one instruction, each range
+// takes one more, and each string in a "{...}" takes two more. The
+// literal characters themselves are kept separately and can total up to
+// kMaxLiteralChars, so a long address costs no more instructions than a
+// short one.
+class CompiledOSCPattern {
+ public:
+  static constexpr int kMaxInstructions = 64;
+  static constexpr int kMaxLiteralChars = 255;
+
+  // Creates an empty pattern. This is not valid and doesn't match
+  // anything until compile is called successfully.
+  CompiledOSCPattern()
+      : progLen_(0), charsLen_(0), literal_(false), valid_(false) {}
+
+  // Creates a pattern and compiles the given string. isValid() will
+  // indicate whether it succeeded.
+  explicit CompiledOSCPattern(const char *pattern) : CompiledOSCPattern() {
+    compile(pattern);
+  }
+
+  // Compiles the given pattern string, replacing any previous pattern.
+  // This returns whether the pattern is well-formed and fits in
+  // kMaxInstructions and kMaxLiteralChars. If not, the pattern is left
+  // invalid.
+  bool compile(const char *pattern) {
+    return compile(pattern, strlen(pattern));
+  }
+
+  // Compiles the first len characters of the given pattern. This is
+  // useful for compiling one part of a longer address.
+  bool compile(const char *pattern, int len);
+
+  // Compiles the address of the given message as a pattern. The message
+  // can be either a LiteOSCParser or an OSCMessageView.
+  bool compile(const OSCMessageView &msg) {
+    return compile(msg.getAddress());
+  }
+  bool compile(const LiteOSCParser &osc) {
+    return compile(osc.view());
+  }
+
+  // Returns whether the last call to compile succeeded.
+  bool isValid() const {
+    return valid_;
+  }
+
+  // Returns whether this pattern has no special characters, in which case
+  // matching is a plain string comparison.
+  bool isLiteral() const {
+    return literal_;
+  }
+
+  // Returns whether the pattern matches the whole address. An invalid
+  // pattern doesn't match anything.
+  bool matches(const char *address) const {
+    return matches(address, strlen(address));
+  }
+
+  // Returns whether the pattern matches the whole of the first len
+  // characters of the address.
+  bool matches(const char *address, int len) const;
+
+  // Returns whether the pattern matches the address of the given message.
+  // The message can be either a LiteOSCParser or an OSCMessageView.
+  bool matches(const OSCMessageView &msg) const {
+    return matches(msg.getAddress());
+  }
+  bool matches(const LiteOSCParser &osc) const {
+    return matches(osc.view());
+  }
+
+  // Returns whether the given string contains any of the special pattern
+  // characters: '?', '*', '[', or '{'.
+  static bool isPattern(const char *s);
+
+  // Returns whether the given character is one of the special pattern
+  // characters.
+  static bool isSpecial(char c);
+
+ private:
+  // Instruction opcodes. The ones up to and including kClass consume
+  // characters and then continue at the next instruction, except that
+  // kClass is followed by its ranges.
+  enum Op : uint8_t {
+    kString,  // Matches the 'b' literal characters starting at 'a'
+    kAny,     // Matches any character but '/'
+    kClass,   // Matches one of the 'a' following kRange instructions,
+              // negated if 'b' is non-zero
+    kRange,   // Part of a kClass; matches 'a' through 'b', inclusive
+    kStar,    // Matches any character but '/' and stays here, or matches
+              // nothing and continues at the next instruction
+    kSplit,   // Continues at both 'a' and 'b'
+    kJump,    // Continues at 'a'
+    kMatch,   // Success, if at the end of the address
+  };
+
+  struct Instruction {
+    Op op;
+    uint8_t a;
+    uint8_t b;
+  };
+
+  // The states being followed at one step of matching, as a set. A state
+  // is an instruction or, partway through a kString, the position of its
+  // next literal character. Every instruction reached is recorded, but
+  // only the ones that consume characters, plus kMatch, are counted. The
+  // first two counted, in order, are remembered for the fast paths.
+  //
+  // The positions partway through each kString are cleared only when its
+  // first one is added, so that clearing the whole set stays cheap.
+  struct StateSet {
+    uint8_t pcs[kMaxInstructions];  // Counted instructions, in order
+    int pcCount;
+    uint32_t seen[(kMaxInstructions + 31)/32];  // All the instructions
+    uint32_t runs[(kMaxInstructions + 31)/32];  // kStrings with positions
+    uint32_t chars[(kMaxLiteralChars + 31)/32];  // Positions in kStrings
+    int count;
+    uint8_t first[2];  // Instruction of each
+    uint8_t firstOff[2];  // Offset into the kString, otherwise zero
+
+    void clear() {
+      pcCount = 0;
+      memset(seen, 0, sizeof(seen));
+      memset(runs, 0, sizeof(runs));
+      count = 0;
+    }
+
+    // Counts a newly-added state. off is the offset into a kString.
+    void record(int pc, int off) {
+      if (count < 2) {
+        first[count] = pc;
+        firstOff[count] = off;
+      }
+      count++;
+    }
+  };
+
+  // Adds an instruction and returns whether there was room.
+  bool emit(Op op, uint8_t a, uint8_t b);
+
+  // Adds a literal character to the kString at *stringPc, or, if that's
+  // negative, to a new one, whose position is then stored there. This
+  // returns whether there was room.
+  bool emitChar(char c, int *stringPc);
+
+  // Adds the instruction at pc, at the given offset if it's a kString, or
+  // everything reachable from it without consuming a character, to the
+  // set. stack is scratch space having room for kMaxInstructions entries.
+  void addThread(StateSet *set, int pc, int off, uint8_t *stack) const;
+
+  // Adds whatever follows the given offset of the kString at pc, which
+  // has just matched a character, to the set.
+  void advance(StateSet *set, int pc, int off, uint8_t *stack) const {
+    if (off + 1 < prog_[pc].b) {
+      addThread(set, pc, off + 1, stack);
+    } else {
+      addThread(set, pc + 1, 0, stack);
+    }
+  }
+
+  // Returns whether the single-character instruction at pc accepts c.
+  bool accepts(int pc, uint8_t c) const;
+
+  // Returns where to continue after the single-character instruction at
+  // pc accepts a character.
+  int nextPc(int pc) const;
+
+  Instruction prog_[kMaxInstructions];
+  int progLen_;
+  char chars_[kMaxLiteralChars];
+  int charsLen_;
+  bool literal_;
+  bool valid_;
+};
+
+// --------------------------------------------------------------------------
+//  Non-member swap
+// --------------------------------------------------------------------------
+
+inline void swap(OSCMessageView &a, OSCMessageView &b) noexcept {
+  a.swap(b);
+}
+
+inline void swap(LiteOSCParser &a, LiteOSCParser &b) noexcept {
+  a.swap(b);
+}
+
+inline void swap(OSCBundle &a, OSCBundle &b) noexcept {
+  a.swap(b);
+}
+
 }  // namespace osc
 }  // namespace qindesign
 
+// Hashes an address at compile time, for comparing against
+// getAddressHash(), for example in a 'case' label.
+#define OSC_ADDR(address) \
+  (::qindesign::osc::OSCMessageView::hashAddress(address))
+
 #endif  // LITEOSCPARSER_H_
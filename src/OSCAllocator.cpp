@@ -0,0 +1,199 @@
+// OSCAllocator.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCAllocator.h"
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstdlib>)
+#include <cstdlib>
+#else
+#include <stdlib.h>
+#endif
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
+#else
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+// Blocks from the arena and pool are aligned to this. Everything the OSC
+// classes store is either bytes or ints, but callers may use the
+// allocators for their own data too.
+#if defined(__AVR__)
+static constexpr size_t kAlignment = 1;
+#else
+static constexpr size_t kAlignment = 8;
+#endif
+
+// Rounds a size or address up to the next multiple of kAlignment.
+static constexpr size_t alignUp(size_t n) {
+  return (n + (kAlignment - 1)) & ~(kAlignment - 1);
+}
+
+// --------------------------------------------------------------------------
+//  OSCAllocator
+// --------------------------------------------------------------------------
+
+OSCAllocator &OSCAllocator::heap() {
+  static OSCHeapAllocator allocator;
+  return allocator;
+}
+
+// --------------------------------------------------------------------------
+//  OSCHeapAllocator
+// --------------------------------------------------------------------------
+
+void *OSCHeapAllocator::allocate(size_t size) {
+  return malloc(size);
+}
+
+void *OSCHeapAllocator::reallocate(void *p, size_t /*oldSize*/,
+                                   size_t newSize) {
+  return realloc(p, newSize);
+}
+
+void OSCHeapAllocator::deallocate(void *p, size_t /*size*/) {
+  free(p);
+}
+
+// --------------------------------------------------------------------------
+//  OSCArenaAllocator
+// --------------------------------------------------------------------------
+
+OSCArenaAllocator::OSCArenaAllocator(void *buf, size_t size)
+    : buf_(static_cast<uint8_t *>(buf)),
+      size_(0),
+      top_(0),
+      last_(nullptr) {
+  // Start at an aligned address
+  size_t skip = alignUp(reinterpret_cast<uintptr_t>(buf_)) -
+                reinterpret_cast<uintptr_t>(buf_);
+  if (buf_ != nullptr && skip < size) {
+    buf_ += skip;
+    size_ = size - skip;
+  }
+}
+
+void *OSCArenaAllocator::allocate(size_t size) {
+  if (size > size_ - top_) {
+    return nullptr;
+  }
+  last_ = &buf_[top_];
+  top_ = alignUp(top_ + size);
+  if (top_ > size_) {
+    top_ = size_;
+  }
+  return last_;
+}
+
+void *OSCArenaAllocator::reallocate(void *p, size_t oldSize, size_t newSize) {
+  if (p == nullptr) {
+    return allocate(newSize);
+  }
+
+  // The most recent block can be resized in place
+  if (p == last_) {
+    size_t start = last_ - buf_;
+    if (newSize > size_ - start) {
+      return nullptr;
+    }
+    top_ = alignUp(start + newSize);
+    if (top_ > size_) {
+      top_ = size_;
+    }
+    return p;
+  }
+
+  if (newSize <= oldSize) {
+    return p;
+  }
+  void *newP = allocate(newSize);
+  if (newP != nullptr) {
+    memcpy(newP, p, oldSize);
+  }
+  return newP;
+}
+
+void OSCArenaAllocator::deallocate(void *p, size_t /*size*/) {
+  // Only the most recent block can be given back
+  if (p != nullptr && p == last_) {
+    top_ = last_ - buf_;
+    last_ = nullptr;
+  }
+}
+
+// --------------------------------------------------------------------------
+//  OSCPoolAllocator
+// --------------------------------------------------------------------------
+
+OSCPoolAllocator::OSCPoolAllocator(void *buf, size_t size, size_t blockSize)
+    : blockSize_(alignUp(blockSize)),
+      blockCount_(0),
+      freeCount_(0),
+      freeList_(nullptr) {
+  if (blockSize_ < sizeof(FreeBlock)) {
+    blockSize_ = alignUp(sizeof(FreeBlock));
+  }
+  if (buf == nullptr) {
+    return;
+  }
+
+  // Start at an aligned address
+  uint8_t *p = static_cast<uint8_t *>(buf);
+  size_t skip = alignUp(reinterpret_cast<uintptr_t>(p)) -
+                reinterpret_cast<uintptr_t>(p);
+  if (skip >= size) {
+    return;
+  }
+  p += skip;
+  blockCount_ = (size - skip) / blockSize_;
+
+  // Thread the list so that blocks are handed out in address order
+  for (size_t i = blockCount_; i-- > 0; ) {
+    FreeBlock *b = reinterpret_cast<FreeBlock *>(&p[i * blockSize_]);
+    b->next = freeList_;
+    freeList_ = b;
+  }
+  freeCount_ = blockCount_;
+}
+
+void *OSCPoolAllocator::allocate(size_t size) {
+  if (size > blockSize_ || freeList_ == nullptr) {
+    return nullptr;
+  }
+  FreeBlock *b = freeList_;
+  freeList_ = b->next;
+  freeCount_--;
+  return b;
+}
+
+void *OSCPoolAllocator::reallocate(void *p, size_t /*oldSize*/,
+                                   size_t newSize) {
+  if (p == nullptr) {
+    return allocate(newSize);
+  }
+  if (newSize > blockSize_) {
+    return nullptr;
+  }
+  return p;
+}
+
+void OSCPoolAllocator::deallocate(void *p, size_t /*size*/) {
+  if (p == nullptr) {
+    return;
+  }
+  FreeBlock *b = static_cast<FreeBlock *>(p);
+  b->next = freeList_;
+  freeList_ = b;
+  freeCount_++;
+}
+
+}  // namespace osc
+}  // namespace qindesign
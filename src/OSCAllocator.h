@@ -0,0 +1,157 @@
+// OSCAllocator.h defines the memory allocators used by the OSC classes.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCALLOCATOR_H_
+#define OSCALLOCATOR_H_
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstddef>)
+#include <cstddef>
+#else
+#include <stddef.h>
+#endif
+#if __has_include(<cstdint>)
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+#else
+#include <cstddef>
+#include <cstdint>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+// OSCAllocator is the interface through which LiteOSCParser, OSCMessageView,
+// and OSCBundle get their memory. The default, returned by heap(), uses
+// malloc, realloc, and free. An allocator must outlive every object that
+// uses it.
+class OSCAllocator {
+ public:
+  virtual ~OSCAllocator() = default;
+
+  // Returns the allocator that uses the heap.
+  static OSCAllocator &heap();
+
+  // Allocates a block of the given size. This returns nullptr if there
+  // isn't enough memory.
+  virtual void *allocate(size_t size) = 0;
+
+  // Resizes a block, moving it if necessary, the same way realloc does.
+  // The block, p, was allocated with oldSize bytes, and may be nullptr.
+  // This returns nullptr if there isn't enough memory, in which case the
+  // original block is left alone.
+  virtual void *reallocate(void *p, size_t oldSize, size_t newSize) = 0;
+
+  // Releases a block having the given size. p may be nullptr.
+  virtual void deallocate(void *p, size_t size) = 0;
+};
+
+// OSCHeapAllocator uses malloc, realloc, and free.
+class OSCHeapAllocator : public OSCAllocator {
+ public:
+  void *allocate(size_t size) override;
+  void *reallocate(void *p, size_t oldSize, size_t newSize) override;
+  void deallocate(void *p, size_t size) override;
+};
+
+// OSCArenaAllocator hands out blocks from a caller-supplied region by
+// bumping a pointer. Nothing is released individually, except that the
+// most recent block can be grown, shrunk, or released in place; instead,
+// reset() releases everything at once. This is useful for building many
+// messages per frame or tick with no heap traffic.
+//
+// All the objects using an arena must be destroyed, or at least not used
+// again, before the arena is reset.
+class OSCArenaAllocator : public OSCAllocator {
+ public:
+  // Creates an arena that uses the given region. The region must remain
+  // valid for as long as this arena is used.
+  OSCArenaAllocator(void *buf, size_t size);
+
+  // Not copyable
+  OSCArenaAllocator(const OSCArenaAllocator &) = delete;
+  OSCArenaAllocator &operator=(const OSCArenaAllocator &) = delete;
+
+  void *allocate(size_t size) override;
+  void *reallocate(void *p, size_t oldSize, size_t newSize) override;
+  void deallocate(void *p, size_t size) override;
+
+  // Releases all the blocks at once.
+  void reset() {
+    top_ = 0;
+    last_ = nullptr;
+  }
+
+  // Returns the number of bytes in use, including alignment padding.
+  size_t used() const {
+    return top_;
+  }
+
+  // Returns the total size of the region.
+  size_t capacity() const {
+    return size_;
+  }
+
+ private:
+  uint8_t *buf_;
+  size_t size_;
+  size_t top_;
+
+  // The most recently allocated block
+  uint8_t *last_;
+};
+
+// OSCPoolAllocator hands out equal-sized blocks from a caller-supplied
+// region. Allocating and releasing are constant-time. A request for more
+// than the block size fails, which means a dynamic buffer using a pool
+// can't grow past one block.
+class OSCPoolAllocator : public OSCAllocator {
+ public:
+  // Creates a pool that divides the given region into blocks of the given
+  // size. The block size is rounded up so that each block is aligned. The
+  // region must remain valid for as long as this pool is used.
+  OSCPoolAllocator(void *buf, size_t size, size_t blockSize);
+
+  // Not copyable
+  OSCPoolAllocator(const OSCPoolAllocator &) = delete;
+  OSCPoolAllocator &operator=(const OSCPoolAllocator &) = delete;
+
+  void *allocate(size_t size) override;
+  void *reallocate(void *p, size_t oldSize, size_t newSize) override;
+  void deallocate(void *p, size_t size) override;
+
+  // Returns the size of each block.
+  size_t blockSize() const {
+    return blockSize_;
+  }
+
+  // Returns the total number of blocks.
+  size_t blockCount() const {
+    return blockCount_;
+  }
+
+  // Returns the number of blocks not in use.
+  size_t freeCount() const {
+    return freeCount_;
+  }
+
+ private:
+  // Free blocks are kept in a list threaded through the blocks themselves.
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  size_t blockSize_;
+  size_t blockCount_;
+  size_t freeCount_;
+  FreeBlock *freeList_;
+};
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCALLOCATOR_H_
@@ -23,20 +23,32 @@
 namespace qindesign {
 namespace osc {
 
-OSCBundle::OSCBundle(int bufCapacity)
+// Swaps two values. This avoids needing <utility>, which isn't available
+// everywhere.
+template <typename T>
+static void swapValues(T &a, T &b) {
+  T t = a;
+  a = b;
+  b = t;
+}
+
+OSCBundle::OSCBundle(int bufCapacity, OSCAllocator *allocator)
     : buf_(nullptr),
       bufSize_(0),
       bufCapacity_(0),
       dynamicBuf_(true),
       memoryErr_(false),
-      isInitted_(false) {
+      allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      reallocCount_(0),
+      isInitted_(false),
+      openCount_(0) {
   static_assert(sizeof(uint8_t) == 1, "sizeof(uint8_t) == 1");
   if (bufCapacity > 0) {
     dynamicBuf_ = false;
     if (bufCapacity < 16) {
       bufCapacity = 16;
     }
-    buf_ = static_cast<uint8_t*>(malloc(bufCapacity));
+    buf_ = static_cast<uint8_t*>(allocator_->allocate(bufCapacity));
     if (buf_ == nullptr) {
       memoryErr_ = true;
     } else {
@@ -45,38 +57,87 @@ OSCBundle::OSCBundle(int bufCapacity)
   }
 }
 
+OSCBundle::OSCBundle(OSCBundle &&other) noexcept
+    : OSCBundle(0, other.allocator_) {
+  swap(other);
+}
+
+OSCBundle &OSCBundle::operator=(OSCBundle &&other) noexcept {
+  if (this != &other) {
+    release();
+    swap(other);
+  }
+  return *this;
+}
+
 OSCBundle::~OSCBundle() {
   if (buf_ != nullptr) {
-    free(buf_);
+    allocator_->deallocate(buf_, bufCapacity_);
+  }
+}
+
+void OSCBundle::swap(OSCBundle &other) noexcept {
+  swapValues(buf_, other.buf_);
+  swapValues(bufSize_, other.bufSize_);
+  swapValues(bufCapacity_, other.bufCapacity_);
+  swapValues(dynamicBuf_, other.dynamicBuf_);
+  swapValues(memoryErr_, other.memoryErr_);
+  swapValues(allocator_, other.allocator_);
+  swapValues(reallocCount_, other.reallocCount_);
+  swapValues(isInitted_, other.isInitted_);
+  for (int i = 0; i < kMaxOpenBundles; i++) {
+    swapValues(openBundles_[i], other.openBundles_[i]);
+  }
+  swapValues(openCount_, other.openCount_);
+}
+
+void OSCBundle::release() {
+  if (buf_ != nullptr) {
+    allocator_->deallocate(buf_, bufCapacity_);
   }
+  buf_ = nullptr;
+  bufSize_ = 0;
+  bufCapacity_ = 0;
+  dynamicBuf_ = true;
+  memoryErr_ = false;
+  reallocCount_ = 0;
+  isInitted_ = false;
+  openCount_ = 0;
 }
 
 bool OSCBundle::init(uint64_t time) {
   if (!ensureCapacity(16)) {
     return false;
   }
-  memcpy(buf_, "#bundle", 8);
-
-  // Use 32-bit values
-  uint32_t t = time >> 32;
-  buf_[8] = t >> 24;
-  buf_[9] = t >> 16;
-  buf_[10] = t >> 8;
-  buf_[11] = t;
-
-  t = time;
-  buf_[12] = t >> 24;
-  buf_[13] = t >> 16;
-  buf_[14] = t >> 8;
-  buf_[15] = t;
-
+  writeHeader(0, time);
   bufSize_ = 16;
+  openCount_ = 0;
 
   isInitted_ = true;
   return true;
 }
 
-bool OSCBundle::addMessage(const LiteOSCParser &osc) {
+bool OSCBundle::reserve(int size) {
+  if (size <= bufCapacity_) {
+    return true;
+  }
+  return dynamicBuf_ && reallocBuf(size);
+}
+
+void OSCBundle::shrinkToFit() {
+  if (!dynamicBuf_ || bufSize_ >= bufCapacity_) {
+    return;
+  }
+  if (bufSize_ == 0) {
+    allocator_->deallocate(buf_, bufCapacity_);
+    buf_ = nullptr;
+    bufCapacity_ = 0;
+  } else {
+    reallocBuf(bufSize_);
+  }
+}
+
+bool OSCBundle::addMessage(const OSCMessageView &osc) {
   return add(osc.getMessageBuf(), osc.getMessageSize());
 }
 
@@ -84,34 +145,33 @@ bool OSCBundle::addBundle(const OSCBundle &bundle) {
   return add(bundle.buf(), bundle.size());
 }
 
-bool OSCBundle::parse(const uint8_t *buf, int32_t len) {
-  if (len < 16 || (len & 0x03) != 0) {
+bool OSCBundle::beginBundle(uint64_t time) {
+  if (!isInitted_ || openCount_ >= kMaxOpenBundles) {
     return false;
   }
-  if (memcmp(buf, "#bundle", 8) != 0) {
+  if (!ensureCapacity(bufSize_ + 4 + 16)) {
     return false;
   }
-  int index = 16;
-  while (index < len) {
-    int32_t size = static_cast<int32_t>(
-        uint32_t{buf[index]} << 24 | uint32_t{buf[index + 1]} << 16 |
-        uint32_t{buf[index + 2]} << 8 | uint32_t{buf[index + 3]});
-    index += 4;
-    if (size <= 0 || (size & 0x03) != 0 || index + size > len) {
-      return false;
-    }
-    if (size >= 8 && memcmp(&buf[index], "#bundle", 8) == 0) {
-      if (!parse(&buf[index], size)) {
-        return false;
-      }
-    } else if (buf[index] != '/') {  // Rudimentary check for an OSC message
-      return false;
-    }
-    index += size;
+  openBundles_[openCount_++] = bufSize_;
+  writeHeader(bufSize_ + 4, time);
+  bufSize_ += 4 + 16;
+  return true;
+}
+
+bool OSCBundle::endBundle() {
+  if (openCount_ <= 0) {
+    return false;
   }
+  int index = openBundles_[--openCount_];
+  writeSize(index, bufSize_ - (index + 4));
   return true;
 }
 
+bool OSCBundle::parse(const uint8_t *buf, int32_t len) {
+  OSCBundleValidator validator{OSCBundleValidator::kMaxDepth};
+  return validator.validate(buf, len);
+}
+
 // --------------------------------------------------------------------------
 //  Private functions
 // --------------------------------------------------------------------------
@@ -124,17 +184,31 @@ bool OSCBundle::add(const uint8_t *buf, int32_t size) {
     return false;
   }
 
-  uint32_t u = static_cast<uint32_t>(size);
-  buf_[bufSize_++] = u >> 24;
-  buf_[bufSize_++] = u >> 16;
-  buf_[bufSize_++] = u >> 8;
-  buf_[bufSize_++] = u;
+  writeSize(bufSize_, size);
+  bufSize_ += 4;
   memcpy(&buf_[bufSize_], buf, size);
   bufSize_ += size;
 
   return true;
 }
 
+void OSCBundle::writeHeader(int index, uint64_t time) {
+  memcpy(&buf_[index], "#bundle", 8);
+
+  // Use 32-bit values
+  uint32_t t = time >> 32;
+  buf_[index + 8] = t >> 24;
+  buf_[index + 9] = t >> 16;
+  buf_[index + 10] = t >> 8;
+  buf_[index + 11] = t;
+
+  t = time;
+  buf_[index + 12] = t >> 24;
+  buf_[index + 13] = t >> 16;
+  buf_[index + 14] = t >> 8;
+  buf_[index + 15] = t;
+}
+
 bool OSCBundle::ensureCapacity(int size) {
   if (size <= bufCapacity_) {
     return true;
@@ -143,12 +217,29 @@ bool OSCBundle::ensureCapacity(int size) {
     memoryErr_ = true;
     return false;
   }
-  buf_ = static_cast<uint8_t*>(realloc(buf_, size));
-  if (buf_ == nullptr) {
+
+  // Grow by half again so that repeated additions don't reallocate every
+  // time, but fall back to the exact size if that much isn't available
+  int newCapacity = bufCapacity_ + bufCapacity_/2;
+  if (newCapacity < size) {
+    newCapacity = size;
+  }
+  if (!reallocBuf(newCapacity) && (newCapacity == size || !reallocBuf(size))) {
     memoryErr_ = true;
     return false;
   }
-  bufCapacity_ = size;
+  return true;
+}
+
+bool OSCBundle::reallocBuf(int capacity) {
+  uint8_t *p = static_cast<uint8_t*>(
+      allocator_->reallocate(buf_, bufCapacity_, capacity));
+  if (p == nullptr) {
+    return false;
+  }
+  buf_ = p;
+  bufCapacity_ = capacity;
+  reallocCount_++;
   return true;
 }
 
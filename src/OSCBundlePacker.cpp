@@ -0,0 +1,65 @@
+// OSCBundlePacker.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCBundlePacker.h"
+
+namespace qindesign {
+namespace osc {
+
+OSCBundlePacker::OSCBundlePacker(int maxSize, OSCPacketHandler handler,
+                                 void *context, OSCAllocator *allocator)
+    : bundle_((maxSize < 16) ? 16 : maxSize, allocator),
+      maxSize_((maxSize < 16) ? 16 : maxSize),
+      time_(0),
+      isInitted_(false),
+      memoryErr_(bundle_.isMemoryError()),
+      handler_(handler),
+      context_(context),
+      flushCount_(0) {}
+
+bool OSCBundlePacker::init(uint64_t time) {
+  time_ = time;
+  isInitted_ = bundle_.init(time);
+  memoryErr_ = !isInitted_;
+  return isInitted_;
+}
+
+bool OSCBundlePacker::addMessage(const OSCMessageView &osc) {
+  return makeRoom(osc.getMessageSize()) && bundle_.addMessage(osc);
+}
+
+bool OSCBundlePacker::addBundle(const OSCBundle &bundle) {
+  return makeRoom(bundle.size()) && bundle_.addBundle(bundle);
+}
+
+bool OSCBundlePacker::flush() {
+  if (!isInitted_ || bundle_.size() <= 16) {
+    return false;
+  }
+  if (handler_ != nullptr) {
+    handler_(bundle_.buf(), bundle_.size(), context_);
+  }
+  flushCount_++;
+  bundle_.init(time_);
+  return true;
+}
+
+bool OSCBundlePacker::makeRoom(int size) {
+  memoryErr_ = false;
+  if (!isInitted_) {
+    return false;
+  }
+
+  // The header, plus the element and its size
+  if (16 + 4 + size > maxSize_) {
+    memoryErr_ = true;
+    return false;
+  }
+  if (bundle_.size() + 4 + size > maxSize_) {
+    flush();
+  }
+  return true;
+}
+
+}  // namespace osc
+}  // namespace qindesign
@@ -0,0 +1,142 @@
+// OSCBundlePacker.h defines a way to split bundles across datagrams.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCBUNDLEPACKER_H_
+#define OSCBUNDLEPACKER_H_
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstdint>)
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+#else
+#include <cstdint>
+#endif
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCAllocator.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCPacketHandler is called by OSCBundlePacker with each finished bundle.
+// The data is only valid until the handler returns. context is whatever
+// was given to the packer.
+using OSCPacketHandler = void (*)(const uint8_t *buf, int size,
+                                  void *context);
+
+// OSCBundlePacker packs elements into bundles no larger than a maximum
+// datagram size, for example the 1472-byte UDP payload that fits an
+// Ethernet frame. Whenever the next element won't fit, the bundle so far
+// is passed to the handler and a new bundle having the same time is
+// started. One buffer of the maximum size is allocated up front and
+// reused for every datagram.
+//
+// An element that can't fit into any datagram by itself is rejected.
+// Call flush() after the last element to send what's left.
+class OSCBundlePacker {
+ public:
+  // Creates a new packer. maxSize is the largest datagram to send, and
+  // should be a multiple of four; it's raised to 16 if smaller. Each
+  // finished bundle is passed to the handler along with the context.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCBundlePacker(int maxSize, OSCPacketHandler handler, void *context,
+                  OSCAllocator *allocator = nullptr);
+
+  // Not copyable
+  OSCBundlePacker(const OSCBundlePacker &) = delete;
+  OSCBundlePacker &operator=(const OSCBundlePacker &) = delete;
+
+  // Starts packing bundles having the given time. Anything not yet
+  // flushed is discarded. This must be called at least once before
+  // anything can be added. This returns whether the buffer could be
+  // allocated.
+  bool init(uint64_t time);
+
+  // Returns whether the buffer couldn't be allocated, or whether the
+  // latest element couldn't fit into a datagram by itself.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Returns the maximum datagram size.
+  int getMaxSize() const {
+    return maxSize_;
+  }
+
+  // Returns the time given to init().
+  uint64_t getTime() const {
+    return time_;
+  }
+
+  // Returns the size of the bundle waiting to be flushed, or zero if no
+  // elements have been added to it.
+  int getPendingSize() const {
+    return (bundle_.size() > 16) ? bundle_.size() : 0;
+  }
+
+  // Returns the number of bundles passed to the handler so far.
+  int getFlushCount() const {
+    return flushCount_;
+  }
+
+  // Adds a message, first flushing the current bundle if the message
+  // won't fit. This returns whether successful.
+  //
+  // The message can be either a LiteOSCParser or an OSCMessageView.
+  bool addMessage(const OSCMessageView &osc);
+  bool addMessage(const LiteOSCParser &osc) {
+    return addMessage(osc.view());
+  }
+
+  // Encodes a message having the given address and arguments, in the same
+  // way as OSCBundle::addMessage, first flushing the current bundle if
+  // the message won't fit. This returns whether successful.
+  template <typename... Args>
+  bool addMessage(const char *address, Args... args);
+
+  // Adds a nested bundle, first flushing the current bundle if the nested
+  // one won't fit. This returns whether successful.
+  bool addBundle(const OSCBundle &bundle);
+
+  // Passes the current bundle to the handler, if it has any elements, and
+  // starts a new one. This returns whether anything was sent.
+  bool flush();
+
+ private:
+  // Makes sure that an element of the given size, not including its own
+  // size prefix, fits into the current bundle, flushing if needed. This
+  // returns false if the element can't fit into any datagram, or if init
+  // hasn't been called.
+  bool makeRoom(int size);
+
+  OSCBundle bundle_;
+  int maxSize_;
+  uint64_t time_;
+  bool isInitted_;
+  bool memoryErr_;
+
+  OSCPacketHandler handler_;
+  void *context_;
+  int flushCount_;
+};
+
+template <typename... Args>
+bool OSCBundlePacker::addMessage(const char *address, Args... args) {
+  int size = LiteOSCParser::messageSize(address, args...);
+  if (size <= 0 || !makeRoom(size)) {
+    return false;
+  }
+  return bundle_.addMessage(address, args...);
+}
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCBUNDLEPACKER_H_
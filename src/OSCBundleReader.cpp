@@ -0,0 +1,69 @@
+// OSCBundleReader.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "LiteOSCParser.h"
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
+#else
+#include <cstring>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+bool OSCBundleReader::init(const uint8_t *buf, int len) {
+  buf_ = nullptr;
+  size_ = 0;
+  elementCount_ = 0;
+
+  if (buf == nullptr || len < 16 || (len & 0x03) != 0) {
+    return false;
+  }
+  if (memcmp(buf, "#bundle", 8) != 0) {
+    return false;
+  }
+
+  // Only the sizes are looked at, so the elements themselves can be
+  // skipped over
+  int count = 0;
+  int index = 16;
+  while (index < len) {
+    if (len - index < 4) {
+      return false;
+    }
+    int32_t size = static_cast<int32_t>(
+        uint32_t{buf[index]} << 24 | uint32_t{buf[index + 1]} << 16 |
+        uint32_t{buf[index + 2]} << 8 | uint32_t{buf[index + 3]});
+    index += 4;
+    if (size <= 0 || (size & 0x03) != 0 || size > len - index) {
+      return false;
+    }
+    index += size;
+    count++;
+  }
+
+  buf_ = buf;
+  size_ = len;
+  elementCount_ = count;
+  return true;
+}
+
+uint64_t OSCBundleReader::getTime() const {
+  if (buf_ == nullptr) {
+    return 0;
+  }
+  uint64_t t = 0;
+  for (int i = 8; i < 16; i++) {
+    t = (t << 8) | buf_[i];
+  }
+  return t;
+}
+
+}  // namespace osc
+}  // namespace qindesign
@@ -0,0 +1,94 @@
+// OSCBundleValidator.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "LiteOSCParser.h"
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
+#else
+#include <cstring>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+OSCBundleValidator::OSCBundleValidator(int maxDepth, int maxElements)
+    : maxDepth_(maxDepth),
+      maxElements_(maxElements),
+      error_(kNoError),
+      errorOffset_(-1),
+      elementCount_(0) {
+  if (maxDepth_ < 1) {
+    maxDepth_ = 1;
+  } else if (maxDepth_ > kMaxDepth) {
+    maxDepth_ = kMaxDepth;
+  }
+}
+
+bool OSCBundleValidator::validate(const uint8_t *buf, int len) {
+  error_ = kNoError;
+  errorOffset_ = -1;
+  elementCount_ = 0;
+
+  if (len < 16 || (len & 0x03) != 0) {
+    return fail(kBadLength, 0);
+  }
+  if (memcmp(buf, "#bundle", 8) != 0) {
+    return fail(kNotBundle, 0);
+  }
+
+  // The end of each open bundle. Because each element's size is checked
+  // against the end of its bundle, the ends are always nested properly.
+  int ends[kMaxDepth];
+  int depth = 1;
+  ends[0] = len;
+  int index = 16;
+  while (true) {
+    while (index == ends[depth - 1]) {
+      if (--depth == 0) {
+        return true;
+      }
+    }
+
+    int end = ends[depth - 1];
+    if (end - index < 4) {
+      return fail(kBadElementSize, index);
+    }
+    int32_t size = static_cast<int32_t>(
+        uint32_t{buf[index]} << 24 | uint32_t{buf[index + 1]} << 16 |
+        uint32_t{buf[index + 2]} << 8 | uint32_t{buf[index + 3]});
+    if (size <= 0 || (size & 0x03) != 0 || size > end - (index + 4)) {
+      return fail(kBadElementSize, index);
+    }
+    elementCount_++;
+    if (maxElements_ > 0 && elementCount_ > maxElements_) {
+      return fail(kTooManyElements, index);
+    }
+    index += 4;
+
+    // Messages are the common case, and can't start like a bundle, so
+    // check for them first
+    if (buf[index] == '/') {  // Rudimentary check for an OSC message
+      index += size;
+    } else if (size >= 8 && memcmp(&buf[index], "#bundle", 8) == 0) {
+      if (size < 16) {
+        return fail(kBadLength, index);
+      }
+      if (depth >= maxDepth_) {
+        return fail(kTooDeep, index);
+      }
+      ends[depth++] = index + size;
+      index += 16;
+    } else {
+      return fail(kBadMessage, index);
+    }
+  }
+}
+
+}  // namespace osc
+}  // namespace qindesign
@@ -0,0 +1,649 @@
+// OSCDispatcher.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCDispatcher.h"
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
+#else
+#include <cstring>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+OSCDispatcher::OSCDispatcher(int maxNodes, int namesCapacity,
+                             OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      nodes_(nullptr),
+      nodeCount_(0),
+      nodesCapacity_(0),
+      dynamicNodes_(true),
+      names_(nullptr),
+      namesSize_(0),
+      namesCapacity_(0),
+      dynamicNames_(true),
+      compact_(true),
+      cache_(nullptr),
+      cacheCapacity_(0),
+      cacheCount_(0),
+      cacheHand_(0),
+      targets_(nullptr),
+      targetsCapacity_(0),
+      targetsSize_(0),
+      cacheHits_(0),
+      cacheMisses_(0) {
+  if (maxNodes > 0) {
+    dynamicNodes_ = false;
+    nodes_ =
+        static_cast<Node *>(allocator_->allocate(maxNodes * sizeof(Node)));
+    if (nodes_ != nullptr) {
+      nodesCapacity_ = maxNodes;
+    }
+  }
+  if (namesCapacity > 0) {
+    dynamicNames_ = false;
+    names_ = static_cast<char *>(allocator_->allocate(namesCapacity));
+    if (names_ == nullptr) {
+      memoryErr_ = true;
+    } else {
+      namesCapacity_ = namesCapacity;
+    }
+  }
+
+  // The root
+  if (!ensureNodesCapacity(1)) {
+    return;
+  }
+  Node &root = nodes_[0];
+  root.name = 0;
+  root.nameLen = 0;
+  root.firstChild = kNone;
+  root.nextSibling = kNone;
+  root.childCount = 0;
+  root.handler = nullptr;
+  root.context = nullptr;
+  root.prefixHandler = nullptr;
+  root.prefixContext = nullptr;
+  nodeCount_ = 1;
+}
+
+OSCDispatcher::~OSCDispatcher() {
+  freeCache();
+  if (nodes_ != nullptr) {
+    allocator_->deallocate(nodes_, nodesCapacity_ * sizeof(Node));
+  }
+  if (names_ != nullptr) {
+    allocator_->deallocate(names_, namesCapacity_);
+  }
+}
+
+// --------------------------------------------------------------------------
+//  Adding handlers
+// --------------------------------------------------------------------------
+
+bool OSCDispatcher::add(const char *address, OSCHandler handler,
+                        void *context) {
+  int node = findOrAdd(address);
+  if (node == kNone) {
+    return false;
+  }
+  nodes_[node].handler = handler;
+  nodes_[node].context = context;
+  clearCache();
+  return true;
+}
+
+bool OSCDispatcher::addPrefix(const char *prefix, OSCHandler handler,
+                              void *context) {
+  int node = findOrAdd(prefix);
+  if (node == kNone) {
+    return false;
+  }
+  nodes_[node].prefixHandler = handler;
+  nodes_[node].prefixContext = context;
+  clearCache();
+  return true;
+}
+
+bool OSCDispatcher::remove(const char *address) {
+  int node = find(address);
+  if (node == kNone || nodes_[node].handler == nullptr) {
+    return false;
+  }
+  nodes_[node].handler = nullptr;
+  nodes_[node].context = nullptr;
+  clearCache();
+  return true;
+}
+
+bool OSCDispatcher::removePrefix(const char *prefix) {
+  int node = find(prefix);
+  if (node == kNone || nodes_[node].prefixHandler == nullptr) {
+    return false;
+  }
+  nodes_[node].prefixHandler = nullptr;
+  nodes_[node].prefixContext = nullptr;
+  clearCache();
+  return true;
+}
+
+int OSCDispatcher::find(const char *address) const {
+  if (nodeCount_ == 0 || address[0] != '/') {
+    return kNone;
+  }
+
+  int node = 0;
+  const char *p = address;
+  while (*p == '/' && node != kNone) {
+    const char *name = ++p;
+    while (*p != '/' && *p != '\0') {
+      p++;
+    }
+    node = findChild(node, name, p - name);
+  }
+  return node;
+}
+
+int OSCDispatcher::findOrAdd(const char *address) {
+  memoryErr_ = false;
+  if (nodeCount_ == 0 || address[0] != '/') {
+    return kNone;
+  }
+
+  int node = 0;
+  const char *p = address;
+  while (*p == '/') {
+    const char *name = ++p;
+    while (*p != '/' && *p != '\0') {
+      p++;
+    }
+    int child = findChild(node, name, p - name);
+    if (child == kNone) {
+      child = addChild(node, name, p - name);
+      if (child == kNone) {
+        return kNone;
+      }
+    }
+    node = child;
+  }
+  return node;
+}
+
+int OSCDispatcher::addChild(int parent, const char *name, int nameLen) {
+  if (!ensureNodesCapacity(nodeCount_ + 1) ||
+      !ensureNamesCapacity(namesSize_ + nameLen)) {
+    return kNone;
+  }
+  if (nameLen > 0) {
+    memcpy(&names_[namesSize_], name, nameLen);
+  }
+
+  // New children go at the front of the list, which means the children
+  // are no longer sorted
+  int index = nodeCount_++;
+  Node &node = nodes_[index];
+  node.name = namesSize_;
+  node.nameLen = nameLen;
+  node.firstChild = kNone;
+  node.nextSibling = nodes_[parent].firstChild;
+  node.childCount = 0;
+  node.handler = nullptr;
+  node.context = nullptr;
+  node.prefixHandler = nullptr;
+  node.prefixContext = nullptr;
+  nodes_[parent].firstChild = index;
+  nodes_[parent].childCount++;
+  namesSize_ += nameLen;
+  compact_ = false;
+  return index;
+}
+
+// --------------------------------------------------------------------------
+//  Compacting
+// --------------------------------------------------------------------------
+
+bool OSCDispatcher::compact() {
+  if (compact_) {
+    return true;
+  }
+  Node *laidOut =
+      static_cast<Node *>(allocator_->allocate(nodeCount_ * sizeof(Node)));
+  if (laidOut == nullptr) {
+    return false;
+  }
+
+  // Copy breadth-first so that each node's children end up together.
+  // Until a node is visited, its firstChild still refers to the old
+  // array.
+  laidOut[0] = nodes_[0];
+  int count = 1;
+  for (int i = 0; i < count; i++) {
+    int first = count;
+    for (int c = laidOut[i].firstChild; c != kNone;
+         c = nodes_[c].nextSibling) {
+      laidOut[count++] = nodes_[c];
+    }
+
+    // Sort the children by name; this is only done once, so an insertion
+    // sort is fine
+    for (int j = first + 1; j < count; j++) {
+      Node n = laidOut[j];
+      int k = j;
+      while (k > first &&
+             compareName(laidOut[k - 1], &names_[n.name], n.nameLen) > 0) {
+        laidOut[k] = laidOut[k - 1];
+        k--;
+      }
+      laidOut[k] = n;
+    }
+
+    for (int j = first; j < count; j++) {
+      laidOut[j].nextSibling = (j + 1 < count) ? j + 1 : kNone;
+    }
+    laidOut[i].firstChild = (count > first) ? first : kNone;
+    laidOut[i].childCount = count - first;
+  }
+
+  memcpy(nodes_, laidOut, nodeCount_ * sizeof(Node));
+  allocator_->deallocate(laidOut, nodeCount_ * sizeof(Node));
+  compact_ = true;
+
+  // The cached targets refer to the old node indexes
+  clearCache();
+  return true;
+}
+
+// --------------------------------------------------------------------------
+//  Pattern cache
+// --------------------------------------------------------------------------
+
+bool OSCDispatcher::setPatternCache(int entries, int targets) {
+  freeCache();
+  cacheHits_ = 0;
+  cacheMisses_ = 0;
+  if (entries <= 0 || targets <= 0) {
+    return true;
+  }
+  cache_ = static_cast<CacheEntry *>(
+      allocator_->allocate(entries * sizeof(CacheEntry)));
+  targets_ =
+      static_cast<Target *>(allocator_->allocate(targets * sizeof(Target)));
+  if (cache_ == nullptr || targets_ == nullptr) {
+    freeCache();
+    return false;
+  }
+  cacheCapacity_ = entries;
+  targetsCapacity_ = targets;
+  return true;
+}
+
+void OSCDispatcher::freeCache() {
+  if (targets_ != nullptr) {
+    allocator_->deallocate(targets_, targetsCapacity_ * sizeof(Target));
+    targets_ = nullptr;
+  }
+  if (cache_ != nullptr) {
+    allocator_->deallocate(cache_, cacheCapacity_ * sizeof(CacheEntry));
+    cache_ = nullptr;
+  }
+  cacheCapacity_ = 0;
+  targetsCapacity_ = 0;
+  clearCache();
+}
+
+OSCDispatcher::CacheEntry *OSCDispatcher::findCached(uint32_t hash,
+                                                     const char *pattern,
+                                                     int len) {
+  for (int i = 0; i < cacheCount_; i++) {
+    CacheEntry &e = cache_[i];
+    if (e.hash == hash && e.len == len &&
+        memcmp(e.pattern, pattern, len) == 0) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+// --------------------------------------------------------------------------
+//  Dispatching
+// --------------------------------------------------------------------------
+
+int OSCDispatcher::dispatch(const OSCMessageView &msg, int offset) {
+  const char *address = msg.getAddress();
+  if (nodeCount_ == 0 || offset < 0 ||
+      (offset > 0 && memchr(address, '\0', offset) != nullptr)) {
+    return 0;
+  }
+
+  const char *p = &address[offset];
+  if (*p != '/') {
+    return 0;
+  }
+  if (CompiledOSCPattern::isPattern(p)) {
+    return dispatchPattern(msg, offset);
+  }
+
+  // Handlers may add to this dispatcher, so only indexes are kept across
+  // calls
+  int called = 0;
+  int node = 0;
+  while (*p == '/') {
+    const char *name = ++p;
+    while (*p != '/' && *p != '\0') {
+      p++;
+    }
+    node = findChild(node, name, p - name);
+    if (node == kNone) {
+      return called;
+    }
+    if (nodes_[node].prefixHandler != nullptr) {
+      nodes_[node].prefixHandler(msg, p - address,
+                                 nodes_[node].prefixContext);
+      called++;
+    }
+  }
+  if (nodes_[node].handler != nullptr) {
+    nodes_[node].handler(msg, p - address, nodes_[node].context);
+    called++;
+  }
+  return called;
+}
+
+int OSCDispatcher::dispatchPattern(const OSCMessageView &msg, int offset) {
+  PatternSearch search;
+  search.msg = &msg;
+  search.base = offset;
+  search.pattern = &msg.getAddress()[offset];
+  search.out = nullptr;
+  search.maxOut = 0;
+  search.count = 0;
+  search.depth = 0;
+
+  int len = strlen(search.pattern);
+  if (cache_ == nullptr || len > kMaxCachedPatternLen) {
+    searchPattern(&search);
+    return search.count;
+  }
+
+  uint32_t hash = OSCMessageView::hashAddress(search.pattern, len);
+  CacheEntry *e = findCached(hash, search.pattern, len);
+  if (e != nullptr) {
+    cacheHits_++;
+    e->recent = true;
+  } else {
+    cacheMisses_++;
+
+    // Record the targets at the end of the pool. Entries that were
+    // replaced don't give their targets back, so when the pool is full,
+    // start again with an empty cache.
+    search.out = &targets_[targetsSize_];
+    search.maxOut = targetsCapacity_ - targetsSize_;
+    searchPattern(&search);
+    if (search.count > search.maxOut && targetsSize_ > 0) {
+      clearCache();
+      search.out = targets_;
+      search.maxOut = targetsCapacity_;
+      search.count = 0;
+      searchPattern(&search);
+    }
+    if (search.count > search.maxOut) {
+      // Too many to remember, so just call them
+      search.out = nullptr;
+      search.count = 0;
+      searchPattern(&search);
+      return search.count;
+    }
+
+    // Choose an entry, giving recently-used ones a second chance
+    if (cacheCount_ < cacheCapacity_) {
+      e = &cache_[cacheCount_++];
+    } else {
+      while (cache_[cacheHand_].recent) {
+        cache_[cacheHand_].recent = false;
+        cacheHand_ = (cacheHand_ + 1) % cacheCapacity_;
+      }
+      e = &cache_[cacheHand_];
+      cacheHand_ = (cacheHand_ + 1) % cacheCapacity_;
+    }
+    e->hash = hash;
+    e->len = len;
+    e->firstTarget = targetsSize_;
+    e->targetCount = search.count;
+    e->recent = false;
+    memcpy(e->pattern, search.pattern, len);
+    targetsSize_ += search.count;
+  }
+
+  // Handlers may add or remove handlers, which clears the cache, but the
+  // targets stay where they are and refer to valid nodes, so copy the
+  // range first
+  int first = e->firstTarget;
+  int count = e->targetCount;
+  int called = 0;
+  for (int i = first; i < first + count; i++) {
+    if (callTarget(msg, offset, targets_[i])) {
+      called++;
+    }
+  }
+  return called;
+}
+
+void OSCDispatcher::searchPattern(PatternSearch *search) {
+  CompiledOSCPattern segment;
+  int compiledDepth = 0;  // The segment at each depth is always the same
+
+  enterNode(search, 0, search->pattern);
+  while (search->depth > 0) {
+    PatternSearch::Level &level = search->levels[search->depth - 1];
+    int child = level.next;
+    if (child == kNone) {
+      search->depth--;
+      continue;
+    }
+
+    if (level.literal) {
+      level.next = kNone;
+    } else {
+      level.next = nodes_[child].nextSibling;
+      if (compiledDepth != search->depth) {
+        if (!segment.compile(level.name, level.nameLen)) {
+          level.next = kNone;
+          continue;
+        }
+        compiledDepth = search->depth;
+      }
+      if (!segment.matches(&names_[nodes_[child].name],
+                           nodes_[child].nameLen)) {
+        continue;
+      }
+    }
+    enterNode(search, child, &level.name[level.nameLen]);
+  }
+}
+
+void OSCDispatcher::enterNode(PatternSearch *search, int node,
+                              const char *p) {
+  int offset = p - search->pattern;
+  if (node != 0 && nodes_[node].prefixHandler != nullptr) {
+    foundTarget(search, node, offset, true);
+  }
+  if (*p == '\0') {
+    if (nodes_[node].handler != nullptr) {
+      foundTarget(search, node, offset, false);
+    }
+    return;
+  }
+  if (search->depth >= kMaxPatternDepth) {
+    return;
+  }
+
+  // Look for the next segment among the children
+  PatternSearch::Level &level = search->levels[search->depth++];
+  level.name = ++p;
+  while (*p != '/' && *p != '\0') {
+    p++;
+  }
+  level.nameLen = p - level.name;
+  level.literal = true;
+  for (int i = 0; i < level.nameLen; i++) {
+    if (CompiledOSCPattern::isSpecial(level.name[i])) {
+      level.literal = false;
+      break;
+    }
+  }
+  if (level.literal) {
+    level.next = findChild(node, level.name, level.nameLen);
+  } else {
+    level.next = nodes_[node].firstChild;
+  }
+}
+
+void OSCDispatcher::foundTarget(PatternSearch *search, int node, int offset,
+                                bool prefix) {
+  if (search->out == nullptr) {
+    Target t{node, offset, prefix};
+    if (callTarget(*search->msg, search->base, t)) {
+      search->count++;
+    }
+    return;
+  }
+  if (search->count < search->maxOut) {
+    Target &t = search->out[search->count];
+    t.node = node;
+    t.offset = offset;
+    t.prefix = prefix;
+  }
+  search->count++;  // Keep counting so that overflow can be seen
+}
+
+bool OSCDispatcher::callTarget(const OSCMessageView &msg, int base,
+                               const Target &t) {
+  const Node &n = nodes_[t.node];
+  OSCHandler handler = t.prefix ? n.prefixHandler : n.handler;
+  if (handler == nullptr) {
+    return false;
+  }
+  handler(msg, base + t.offset, t.prefix ? n.prefixContext : n.context);
+  return true;
+}
+
+void OSCDispatcher::delegate(const OSCMessageView &msg, int offset,
+                             void *dispatcher) {
+  static_cast<OSCDispatcher *>(dispatcher)->dispatch(msg, offset);
+}
+
+// --------------------------------------------------------------------------
+//  Private functions
+// --------------------------------------------------------------------------
+
+int OSCDispatcher::compareName(const Node &node, const char *name,
+                               int nameLen) const {
+  int len = (node.nameLen < nameLen) ? node.nameLen : nameLen;
+  if (len > 0) {
+    int cmp = memcmp(&names_[node.name], name, len);
+    if (cmp != 0) {
+      return cmp;
+    }
+  }
+  return node.nameLen - nameLen;
+}
+
+int OSCDispatcher::findChild(int parent, const char *name, int nameLen) const {
+  const Node &p = nodes_[parent];
+  if (compact_) {
+    int lo = p.firstChild;
+    int hi = p.firstChild + p.childCount;  // Exclusive
+    while (lo < hi) {
+      int mid = lo + (hi - lo)/2;
+      int cmp = compareName(nodes_[mid], name, nameLen);
+      if (cmp == 0) {
+        return mid;
+      }
+      if (cmp < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return kNone;
+  }
+
+  for (int c = p.firstChild; c != kNone; c = nodes_[c].nextSibling) {
+    if (nodes_[c].nameLen == nameLen &&
+        (nameLen == 0 ||
+         memcmp(&names_[nodes_[c].name], name, nameLen) == 0)) {
+      return c;
+    }
+  }
+  return kNone;
+}
+
+bool OSCDispatcher::ensureNodesCapacity(int size) {
+  if (size <= nodesCapacity_) {
+    return true;
+  }
+  if (!dynamicNodes_) {
+    memoryErr_ = true;
+    return false;
+  }
+
+  // Grow by half again, falling back to the exact size
+  int newCapacity = nodesCapacity_ + nodesCapacity_/2;
+  if (newCapacity < size) {
+    newCapacity = size;
+  }
+  Node *p = static_cast<Node *>(allocator_->reallocate(
+      nodes_, nodesCapacity_ * sizeof(Node), newCapacity * sizeof(Node)));
+  if (p == nullptr && newCapacity != size) {
+    newCapacity = size;
+    p = static_cast<Node *>(allocator_->reallocate(
+        nodes_, nodesCapacity_ * sizeof(Node), newCapacity * sizeof(Node)));
+  }
+  if (p == nullptr) {
+    memoryErr_ = true;
+    return false;
+  }
+  nodes_ = p;
+  nodesCapacity_ = newCapacity;
+  return true;
+}
+
+bool OSCDispatcher::ensureNamesCapacity(int size) {
+  if (size <= namesCapacity_) {
+    return true;
+  }
+  if (!dynamicNames_) {
+    memoryErr_ = true;
+    return false;
+  }
+
+  // Grow by half again, falling back to the exact size
+  int newCapacity = namesCapacity_ + namesCapacity_/2;
+  if (newCapacity < size) {
+    newCapacity = size;
+  }
+  char *p = static_cast<char *>(
+      allocator_->reallocate(names_, namesCapacity_, newCapacity));
+  if (p == nullptr && newCapacity != size) {
+    newCapacity = size;
+    p = static_cast<char *>(
+        allocator_->reallocate(names_, namesCapacity_, newCapacity));
+  }
+  if (p == nullptr) {
+    memoryErr_ = true;
+    return false;
+  }
+  names_ = p;
+  namesCapacity_ = newCapacity;
+  return true;
+}
+
+}  // namespace osc
+}  // namespace qindesign
@@ -0,0 +1,322 @@
+// OSCDispatcher.h defines a way to route OSC messages to handlers.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCDISPATCHER_H_
+#define OSCDISPATCHER_H_
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstdint>)
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+#else
+#include <cstdint>
+#endif
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCAllocator.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCHandler is called by OSCDispatcher when a message matches. offset is
+// the index into the message's address just past the part that matched,
+// i.e. the index of the next '/' or of the terminating NULL, in the same
+// way as the return value of OSCMessageView::match. context is whatever
+// was given when the handler was added.
+using OSCHandler = void (*)(const OSCMessageView &msg, int offset,
+                            void *context);
+
+// OSCDispatcher routes messages to handlers by address, instead of
+// comparing the address against each one in turn. Addresses are stored
+// in a trie having one node per container or method name, so the time
+// to route a message depends on the length of its address and not on
+// the number of handlers.
+//
+// There are two kinds of handler. An address handler is called when the
+// whole address matches. A prefix handler is called when the address
+// starts with the given containers, in the same way as
+// OSCMessageView::match; it receives the offset of the rest of the
+// address and can pass the message on, for example to another
+// dispatcher. For a message, all the prefix handlers along its address
+// are called first, from the shortest prefix to the longest, and then
+// the address handler.
+//
+// Before compact() is called, or after something is added, each node's
+// children are searched one by one. compact() lays the nodes out again
+// in one contiguous array with each node's children together and sorted,
+// so that they can be binary searched.
+//
+// An incoming address may itself be an OSC address pattern, such as
+// "/synth/*/gain", in which case it's routed to every registered address
+// that it matches, as well as to the prefix handlers along the way. Since
+// this means searching the trie, the results for recent patterns can be
+// kept in a bounded cache; see setPatternCache(). The cache is cleared
+// whenever a handler is added or removed, or the trie is compacted.
+//
+// Like the other classes, the internal arrays can be dynamically
+// allocated or fixed in size, and isMemoryError() reports when something
+// couldn't be added because there wasn't room.
+class OSCDispatcher {
+ public:
+  // Creates a new dispatcher. If maxNodes is positive then the number of
+  // trie nodes, one per distinct container or method, including the root,
+  // is limited to that many. Similarly, if namesCapacity is positive then
+  // it limits the total number of characters in the names. Otherwise,
+  // those are dynamically allocated as needed.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCDispatcher(int maxNodes, int namesCapacity,
+                OSCAllocator *allocator = nullptr);
+
+  // Creates a new dispatcher that allocates as needed.
+  OSCDispatcher() : OSCDispatcher(0, 0) {}
+
+  // Not copyable
+  OSCDispatcher(const OSCDispatcher &) = delete;
+  OSCDispatcher &operator=(const OSCDispatcher &) = delete;
+
+  ~OSCDispatcher();
+
+  // Returns whether there wasn't enough room for the last addition.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Returns the number of trie nodes, including the root.
+  int getNodeCount() const {
+    return nodeCount_;
+  }
+
+  // Returns whether the nodes are currently laid out by compact().
+  bool isCompact() const {
+    return compact_;
+  }
+
+  // Adds a handler for the given address, replacing any previous one.
+  // The address must start with a '/'. This returns whether successful.
+  bool add(const char *address, OSCHandler handler, void *context);
+
+  // Adds a handler for any address that starts with the given containers,
+  // replacing any previous one for the same prefix. The prefix must start
+  // with a '/' and must not end with one. This returns whether
+  // successful.
+  bool addPrefix(const char *prefix, OSCHandler handler, void *context);
+
+  // Removes the handler for the given address. This returns whether there
+  // was one.
+  bool remove(const char *address);
+
+  // Removes the handler for the given prefix. This returns whether there
+  // was one.
+  bool removePrefix(const char *prefix);
+
+  // Sends any address starting with the given prefix to another
+  // dispatcher, which then sees only the rest of the address. For
+  // example, if "/mixer" is delegated, then the other dispatcher routes
+  // "/mixer/ch/1" as if it were "/ch/1". The other dispatcher must
+  // outlive this one.
+  bool addDispatcher(const char *prefix, OSCDispatcher *sub) {
+    return addPrefix(prefix, &delegate, sub);
+  }
+
+  // Lays out the nodes again for faster lookups. This needs room for a
+  // second copy of the node array while it works. It returns whether
+  // successful; if not, the dispatcher still works, just as before.
+  bool compact();
+
+  // Sets up the cache of pattern results, replacing any previous one.
+  // Up to 'entries' patterns are remembered, having a total of up to
+  // 'targets' handlers among them. Patterns longer than
+  // kMaxCachedPatternLen aren't cached. Passing zero for either disables
+  // the cache, which is the default. This returns whether there was
+  // enough memory; if not, the cache is disabled.
+  bool setPatternCache(int entries, int targets);
+
+  // Returns the number of pattern lookups that were found in the cache.
+  uint32_t getPatternCacheHits() const {
+    return cacheHits_;
+  }
+
+  // Returns the number of pattern lookups that weren't found in the
+  // cache.
+  uint32_t getPatternCacheMisses() const {
+    return cacheMisses_;
+  }
+
+  // Routes the message to all the matching handlers and returns how many
+  // were called. Matching starts at 'offset' in the address, which must
+  // be the index of a '/'; this is how delegation to another dispatcher
+  // works.
+  //
+  // A handler may add or remove handlers, but must not compact this
+  // dispatcher or dispatch another pattern with it.
+  //
+  // The message can be either a LiteOSCParser or an OSCMessageView.
+  int dispatch(const OSCMessageView &msg, int offset = 0);
+  int dispatch(const LiteOSCParser &osc, int offset = 0) {
+    return dispatch(osc.view(), offset);
+  }
+
+  // An OSCHandler that passes the message on to the dispatcher given as
+  // the context.
+  static void delegate(const OSCMessageView &msg, int offset,
+                       void *dispatcher);
+
+  // The longest pattern, not counting the NULL, that can be cached.
+  static constexpr int kMaxCachedPatternLen = 32;
+
+  // The maximum number of containers in an incoming pattern. Anything
+  // deeper doesn't match.
+  static constexpr int kMaxPatternDepth = 16;
+
+ private:
+  static constexpr int kNone = -1;
+
+  struct Node {
+    int name;  // Index into names_
+    int nameLen;
+    int firstChild;
+    int nextSibling;
+    int childCount;
+
+    OSCHandler handler;
+    void *context;
+    OSCHandler prefixHandler;
+    void *prefixContext;
+  };
+
+  // A handler found for a pattern. The offset is relative to the start of
+  // the pattern.
+  struct Target {
+    int node;
+    int offset;
+    bool prefix;
+  };
+
+  // A cached pattern and where its targets are in targets_.
+  struct CacheEntry {
+    uint32_t hash;
+    int len;
+    int firstTarget;
+    int targetCount;
+    bool recent;  // For choosing what to replace
+    char pattern[kMaxCachedPatternLen];
+  };
+
+  // The state of a search for the targets of a pattern. If 'out' is
+  // nullptr then the handlers are called as they're found; otherwise,
+  // up to maxOut targets are stored there.
+  struct PatternSearch {
+    const OSCMessageView *msg;
+    int base;  // Offset of the pattern in the message's address
+    const char *pattern;
+    Target *out;
+    int maxOut;
+    int count;
+
+    // One level per container still being searched
+    struct Level {
+      const char *name;
+      int nameLen;
+      bool literal;
+      int next;  // The next child to try
+    };
+    Level levels[kMaxPatternDepth];
+    int depth;
+  };
+
+  // Searches for the targets of a pattern, which starts with a '/'.
+  void searchPattern(PatternSearch *search);
+
+  // Called when the search reaches a node. p is just past the part of the
+  // pattern that led there.
+  void enterNode(PatternSearch *search, int node, const char *p);
+
+  // Calls or stores one target.
+  void foundTarget(PatternSearch *search, int node, int offset, bool prefix);
+
+  // Dispatches a pattern, using the cache if there is one.
+  int dispatchPattern(const OSCMessageView &msg, int offset);
+
+  // Calls the handler for a target, if it still has one, and returns
+  // whether it was called.
+  bool callTarget(const OSCMessageView &msg, int base, const Target &t);
+
+  // Finds a pattern in the cache, or returns nullptr.
+  CacheEntry *findCached(uint32_t hash, const char *pattern, int len);
+
+  // Forgets all the cached patterns.
+  void clearCache() {
+    cacheCount_ = 0;
+    targetsSize_ = 0;
+    cacheHand_ = 0;
+  }
+
+  // Releases the cache memory.
+  void freeCache();
+
+  // Finds the node for the given address without adding anything, or
+  // returns kNone.
+  int find(const char *address) const;
+
+  // Finds or adds the node for the given address, or prefix, and returns
+  // its index, or kNone if there wasn't enough room or the address is
+  // malformed.
+  int findOrAdd(const char *address);
+
+  // Finds the child of the given node having the given name, or kNone.
+  int findChild(int parent, const char *name, int nameLen) const;
+
+  // Adds a child to the given node and returns its index, or kNone if
+  // there isn't enough room.
+  int addChild(int parent, const char *name, int nameLen);
+
+  // Compares a node's name with the given name, in the same way as
+  // strcmp.
+  int compareName(const Node &node, const char *name, int nameLen) const;
+
+  // Ensures that we have enough room for the given number of nodes or
+  // name characters. These return whether we do, allocating if necessary.
+  // If there isn't enough space then the memory error condition will be
+  // set to 'true'.
+  bool ensureNodesCapacity(int size);
+  bool ensureNamesCapacity(int size);
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  Node *nodes_;
+  int nodeCount_;
+  int nodesCapacity_;
+  bool dynamicNodes_;
+
+  char *names_;
+  int namesSize_;
+  int namesCapacity_;
+  bool dynamicNames_;
+
+  // Whether each node's children are contiguous and sorted
+  bool compact_;
+
+  // Pattern cache
+  CacheEntry *cache_;
+  int cacheCapacity_;
+  int cacheCount_;
+  int cacheHand_;
+  Target *targets_;
+  int targetsCapacity_;
+  int targetsSize_;
+  uint32_t cacheHits_;
+  uint32_t cacheMisses_;
+};
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCDISPATCHER_H_
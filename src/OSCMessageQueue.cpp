@@ -0,0 +1,247 @@
+// OSCMessageQueue.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCMessageQueue.h"
+
+#ifdef OSCMESSAGEQUEUE_AVAILABLE_
+
+// C++ includes
+#include <cstring>
+#include <new>
+
+namespace qindesign {
+namespace osc {
+
+// Rounds a slot count up to a power of two, returning one less than that.
+static uint32_t slotMask(int slotCount) {
+  uint32_t n = 1;
+  while (n < static_cast<uint32_t>(slotCount) && n < (uint32_t{1} << 30)) {
+    n <<= 1;
+  }
+  return n - 1;
+}
+
+// --------------------------------------------------------------------------
+//  OSCSpscQueue
+// --------------------------------------------------------------------------
+
+OSCSpscQueue::OSCSpscQueue(int slotCount, int slotSize,
+                           OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      mask_(slotMask(slotCount)),
+      slotSize_((slotSize < 0) ? 0 : slotSize),
+      stride_(0),
+      slab_(nullptr),
+      sizes_(nullptr),
+      tail_(0),
+      headCache_(0),
+      head_(0),
+      tailCache_(0),
+      dropped_(0) {
+  // Keep each slot aligned
+  stride_ = (slotSize_ + 7) & ~7;
+
+  if (stride_ > 0) {
+    slab_ = static_cast<uint8_t *>(
+        allocator_->allocate((mask_ + 1) * stride_));
+  }
+  sizes_ = static_cast<int *>(allocator_->allocate((mask_ + 1) * sizeof(int)));
+  if ((stride_ > 0 && slab_ == nullptr) || sizes_ == nullptr) {
+    memoryErr_ = true;
+  }
+}
+
+OSCSpscQueue::~OSCSpscQueue() {
+  allocator_->deallocate(sizes_, (mask_ + 1) * sizeof(int));
+  allocator_->deallocate(slab_, (mask_ + 1) * stride_);
+}
+
+bool OSCSpscQueue::push(const uint8_t *buf, int size) {
+  uint8_t *p = nullptr;
+  if (size <= 0 || size > slotSize_ || (p = claim()) == nullptr) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  memcpy(p, buf, size);
+  commit(size);
+  return true;
+}
+
+const uint8_t *OSCSpscQueue::front(int *size) {
+  uint32_t h = head_.load(std::memory_order_relaxed);
+  if (h == tailCache_) {
+    tailCache_ = tail_.load(std::memory_order_acquire);
+    if (h == tailCache_) {
+      return nullptr;
+    }
+  }
+  *size = sizes_[h & mask_];
+  return &slab_[(h & mask_) * stride_];
+}
+
+bool OSCSpscQueue::front(OSCMessageView *view) {
+  int size;
+  const uint8_t *buf = front(&size);
+  return buf != nullptr && view->parse(buf, size);
+}
+
+bool OSCSpscQueue::pop() {
+  uint32_t h = head_.load(std::memory_order_relaxed);
+  if (h == tailCache_) {
+    tailCache_ = tail_.load(std::memory_order_acquire);
+    if (h == tailCache_) {
+      return false;
+    }
+  }
+  head_.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+int OSCSpscQueue::getSize() const {
+  uint32_t t = tail_.load(std::memory_order_acquire);
+  uint32_t h = head_.load(std::memory_order_acquire);
+  return static_cast<int>(t - h);
+}
+
+uint8_t *OSCSpscQueue::claim() {
+  if (memoryErr_) {
+    return nullptr;
+  }
+  uint32_t t = tail_.load(std::memory_order_relaxed);
+  if (t - headCache_ > mask_) {
+    headCache_ = head_.load(std::memory_order_acquire);
+    if (t - headCache_ > mask_) {
+      return nullptr;
+    }
+  }
+  return &slab_[(t & mask_) * stride_];
+}
+
+void OSCSpscQueue::commit(int size) {
+  uint32_t t = tail_.load(std::memory_order_relaxed);
+  sizes_[t & mask_] = size;
+  tail_.store(t + 1, std::memory_order_release);
+}
+
+// --------------------------------------------------------------------------
+//  OSCMpscQueue
+// --------------------------------------------------------------------------
+
+OSCMpscQueue::OSCMpscQueue(int slotCount, int slotSize,
+                           OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      // A filled slot's sequence equals the free sequence for the next
+      // lap when there's only one slot, so there must be at least two
+      mask_(slotMask((slotCount < 2) ? 2 : slotCount)),
+      slotSize_((slotSize < 0) ? 0 : slotSize),
+      stride_(0),
+      slab_(nullptr),
+      sizes_(nullptr),
+      seqs_(nullptr),
+      tail_(0),
+      head_(0),
+      dropped_(0) {
+  // Keep each slot aligned
+  stride_ = (slotSize_ + 7) & ~7;
+
+  if (stride_ > 0) {
+    slab_ = static_cast<uint8_t *>(
+        allocator_->allocate((mask_ + 1) * stride_));
+  }
+  sizes_ = static_cast<int *>(allocator_->allocate((mask_ + 1) * sizeof(int)));
+  seqs_ = static_cast<std::atomic<uint32_t> *>(allocator_->allocate(
+      (mask_ + 1) * sizeof(std::atomic<uint32_t>)));
+  if ((stride_ > 0 && slab_ == nullptr) || sizes_ == nullptr ||
+      seqs_ == nullptr) {
+    memoryErr_ = true;
+    return;
+  }
+  for (uint32_t i = 0; i <= mask_; i++) {
+    new (&seqs_[i]) std::atomic<uint32_t>(i);
+  }
+}
+
+OSCMpscQueue::~OSCMpscQueue() {
+  // std::atomic<uint32_t> has a trivial destructor
+  allocator_->deallocate(seqs_, (mask_ + 1) * sizeof(std::atomic<uint32_t>));
+  allocator_->deallocate(sizes_, (mask_ + 1) * sizeof(int));
+  allocator_->deallocate(slab_, (mask_ + 1) * stride_);
+}
+
+bool OSCMpscQueue::push(const uint8_t *buf, int size) {
+  uint32_t pos;
+  if (size <= 0 || size > slotSize_ || !claim(&pos)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  memcpy(&slab_[(pos & mask_) * stride_], buf, size);
+  commit(pos, size);
+  return true;
+}
+
+const uint8_t *OSCMpscQueue::front(int *size) {
+  if (memoryErr_) {
+    return nullptr;
+  }
+  uint32_t seq = seqs_[head_ & mask_].load(std::memory_order_acquire);
+  if (seq != head_ + 1) {
+    return nullptr;
+  }
+  *size = sizes_[head_ & mask_];
+  return &slab_[(head_ & mask_) * stride_];
+}
+
+bool OSCMpscQueue::front(OSCMessageView *view) {
+  int size;
+  const uint8_t *buf = front(&size);
+  return buf != nullptr && view->parse(buf, size);
+}
+
+bool OSCMpscQueue::pop() {
+  int size;
+  if (front(&size) == nullptr) {
+    return false;
+  }
+
+  // Free the slot for the position one lap later
+  seqs_[head_ & mask_].store(head_ + mask_ + 1, std::memory_order_release);
+  head_++;
+  return true;
+}
+
+bool OSCMpscQueue::claim(uint32_t *pos) {
+  if (memoryErr_) {
+    return false;
+  }
+  uint32_t p = tail_.load(std::memory_order_relaxed);
+  while (true) {
+    uint32_t seq = seqs_[p & mask_].load(std::memory_order_acquire);
+    int32_t diff = static_cast<int32_t>(seq - p);
+    if (diff == 0) {
+      // The slot is free; try to take it
+      if (tail_.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) {
+        *pos = p;
+        return true;
+      }
+      // p now holds the current tail
+    } else if (diff < 0) {
+      // The slot still holds a message from the previous lap
+      return false;
+    } else {
+      // Another producer took this position
+      p = tail_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void OSCMpscQueue::commit(uint32_t pos, int size) {
+  sizes_[pos & mask_] = size;
+  seqs_[pos & mask_].store(pos + 1, std::memory_order_release);
+}
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCMESSAGEQUEUE_AVAILABLE_
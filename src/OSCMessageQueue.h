@@ -0,0 +1,274 @@
+// OSCMessageQueue.h defines lock-free queues for passing OSC messages
+// between threads. This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCMESSAGEQUEUE_H_
+#define OSCMESSAGEQUEUE_H_
+
+// These need <atomic>, which not every platform has
+#if defined(__has_include)
+#if __has_include(<atomic>)
+#define OSCMESSAGEQUEUE_AVAILABLE_
+#endif
+#endif
+
+#ifdef OSCMESSAGEQUEUE_AVAILABLE_
+
+// C++ includes
+#include <atomic>
+#include <cstdint>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCAllocator.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCSpscQueue passes encoded messages from one producer thread to one
+// consumer thread, for example from a network thread to an audio
+// callback. Messages are stored inline in a fixed number of fixed-size
+// slots allocated up front, so neither side allocates or locks, and every
+// operation finishes in a bounded number of steps.
+//
+// The producer either copies an encoded message in with push() or
+// encodes one directly into a slot with pushMessage(). The consumer
+// parses the oldest message in place with front(), uses it, and then
+// releases its slot with pop().
+class OSCSpscQueue {
+ public:
+  // Creates a queue having at least slotCount slots, rounded up to a
+  // power of two, each holding a message of up to slotSize bytes.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCSpscQueue(int slotCount, int slotSize,
+               OSCAllocator *allocator = nullptr);
+
+  // Not copyable
+  OSCSpscQueue(const OSCSpscQueue &) = delete;
+  OSCSpscQueue &operator=(const OSCSpscQueue &) = delete;
+
+  ~OSCSpscQueue();
+
+  // Returns whether the slots couldn't be allocated.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Returns the number of slots.
+  int getSlotCount() const {
+    return static_cast<int>(mask_ + 1);
+  }
+
+  // Returns the largest message a slot can hold.
+  int getSlotSize() const {
+    return slotSize_;
+  }
+
+  // ------------------------------------------------------------------------
+  //  Producer
+  // ------------------------------------------------------------------------
+
+  // Copies an encoded message into the queue. This returns false, and
+  // counts a drop, if the queue is full or the message is too large.
+  bool push(const uint8_t *buf, int size);
+
+  // Encodes a message having the given address and arguments directly
+  // into the queue, in the same way as LiteOSCParser::build. This returns
+  // false, and counts a drop, if the queue is full or the message is too
+  // large.
+  template <typename... Args>
+  bool pushMessage(const char *address, Args... args);
+
+  // ------------------------------------------------------------------------
+  //  Consumer
+  // ------------------------------------------------------------------------
+
+  // Returns the oldest message without removing it, and stores its size
+  // in 'size', or returns nullptr if the queue is empty. The data stays
+  // valid until pop() is called.
+  const uint8_t *front(int *size);
+
+  // Parses the oldest message in place into the given view, without
+  // removing it. This returns false if the queue is empty or the message
+  // isn't valid. The view stays valid until pop() is called. To avoid
+  // allocating, give the view a fixed maximum argument count.
+  bool front(OSCMessageView *view);
+
+  // Removes the oldest message and returns whether there was one.
+  bool pop();
+
+  // ------------------------------------------------------------------------
+  //  Either side
+  // ------------------------------------------------------------------------
+
+  // Returns the number of messages in the queue. This may be out of date
+  // by the time it returns if the other side is active.
+  int getSize() const;
+
+  // Returns the number of messages that couldn't be pushed.
+  uint32_t getDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Returns the slot for the next push, or nullptr if the queue is full.
+  uint8_t *claim();
+
+  // Publishes the claimed slot having the given size.
+  void commit(int size);
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  uint32_t mask_;  // Slot count minus one
+  int slotSize_;
+  int stride_;  // Slot size rounded up for alignment
+  uint8_t *slab_;
+  int *sizes_;
+
+  // The two sides' indexes are kept apart so that they don't share a
+  // cache line. Each side also caches the other's index and only reloads
+  // it when the queue looks full or empty.
+  alignas(64) std::atomic<uint32_t> tail_;  // Written by the producer
+  uint32_t headCache_;
+  alignas(64) std::atomic<uint32_t> head_;  // Written by the consumer
+  uint32_t tailCache_;
+  alignas(64) std::atomic<uint32_t> dropped_;
+};
+
+// OSCMpscQueue is like OSCSpscQueue, but any number of producer threads
+// may push at the same time. Each slot has a sequence number that says
+// whether it's free or filled; producers claim slots with a
+// compare-and-swap, so pushing is lock-free rather than wait-free, while
+// the consumer's side is still wait-free.
+//
+// A producer that stops partway through a push holds up the consumer at
+// that slot until it finishes.
+class OSCMpscQueue {
+ public:
+  // Creates a queue having at least slotCount slots, rounded up to a
+  // power of two, each holding a message of up to slotSize bytes. There
+  // are always at least two slots.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCMpscQueue(int slotCount, int slotSize,
+               OSCAllocator *allocator = nullptr);
+
+  // Not copyable
+  OSCMpscQueue(const OSCMpscQueue &) = delete;
+  OSCMpscQueue &operator=(const OSCMpscQueue &) = delete;
+
+  ~OSCMpscQueue();
+
+  // Returns whether the slots couldn't be allocated.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Returns the number of slots.
+  int getSlotCount() const {
+    return static_cast<int>(mask_ + 1);
+  }
+
+  // Returns the largest message a slot can hold.
+  int getSlotSize() const {
+    return slotSize_;
+  }
+
+  // Copies an encoded message into the queue. This may be called from any
+  // number of threads. This returns false, and counts a drop, if the
+  // queue is full or the message is too large.
+  bool push(const uint8_t *buf, int size);
+
+  // Encodes a message having the given address and arguments directly
+  // into the queue. This may be called from any number of threads. This
+  // returns false, and counts a drop, if the queue is full or the message
+  // is too large.
+  template <typename... Args>
+  bool pushMessage(const char *address, Args... args);
+
+  // Returns the oldest message without removing it, and stores its size
+  // in 'size', or returns nullptr if the queue is empty. This is only
+  // called by the consumer. The data stays valid until pop() is called.
+  const uint8_t *front(int *size);
+
+  // Parses the oldest message in place into the given view, without
+  // removing it. This is only called by the consumer. This returns false
+  // if the queue is empty or the message isn't valid.
+  bool front(OSCMessageView *view);
+
+  // Removes the oldest message and returns whether there was one. This is
+  // only called by the consumer.
+  bool pop();
+
+  // Returns the number of messages that couldn't be pushed.
+  uint32_t getDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Claims a slot for a push and stores its position in 'pos'. This
+  // returns false if the queue is full.
+  bool claim(uint32_t *pos);
+
+  // Publishes the slot at the given position having the given size.
+  void commit(uint32_t pos, int size);
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  uint32_t mask_;  // Slot count minus one
+  int slotSize_;
+  int stride_;  // Slot size rounded up for alignment
+  uint8_t *slab_;
+  int *sizes_;
+
+  // A slot at position pos is free for that position when its sequence is
+  // pos, and filled when it's pos + 1
+  std::atomic<uint32_t> *seqs_;
+
+  alignas(64) std::atomic<uint32_t> tail_;  // Shared by the producers
+  alignas(64) uint32_t head_;  // Only used by the consumer
+  alignas(64) std::atomic<uint32_t> dropped_;
+};
+
+// --------------------------------------------------------------------------
+//  Template implementations
+// --------------------------------------------------------------------------
+
+template <typename... Args>
+bool OSCSpscQueue::pushMessage(const char *address, Args... args) {
+  int size = LiteOSCParser::messageSize(address, args...);
+  uint8_t *buf = nullptr;
+  if (size <= 0 || size > slotSize_ || (buf = claim()) == nullptr) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  LiteOSCParser::buildMessage(buf, size, address, args...);
+  commit(size);
+  return true;
+}
+
+template <typename... Args>
+bool OSCMpscQueue::pushMessage(const char *address, Args... args) {
+  int size = LiteOSCParser::messageSize(address, args...);
+  uint32_t pos;
+  if (size <= 0 || size > slotSize_ || !claim(&pos)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  LiteOSCParser::buildMessage(&slab_[(pos & mask_) * stride_], size, address,
+                              args...);
+  commit(pos, size);
+  return true;
+}
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCMESSAGEQUEUE_AVAILABLE_
+
+#endif  // OSCMESSAGEQUEUE_H_
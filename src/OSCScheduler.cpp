@@ -0,0 +1,174 @@
+// OSCScheduler.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCScheduler.h"
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
+#else
+#include <cstring>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+// The time tag that means "immediately".
+static constexpr uint64_t kImmediately = 1;
+
+OSCScheduler::OSCScheduler(int capacity, OSCScheduledHandler handler,
+                           void *context, OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      heap_(nullptr),
+      size_(0),
+      capacity_(0),
+      dynamic_(true),
+      nextSeq_(0),
+      handler_(handler),
+      context_(context) {
+  if (capacity > 0) {
+    dynamic_ = false;
+    heap_ = static_cast<Entry *>(
+        allocator_->allocate(capacity * sizeof(Entry)));
+    if (heap_ == nullptr) {
+      memoryErr_ = true;
+    } else {
+      capacity_ = capacity;
+    }
+  }
+}
+
+OSCScheduler::~OSCScheduler() {
+  if (heap_ != nullptr) {
+    allocator_->deallocate(heap_, capacity_ * sizeof(Entry));
+  }
+}
+
+bool OSCScheduler::schedule(const uint8_t *buf, int size) {
+  if (size < 16 || memcmp(buf, "#bundle", 8) != 0) {
+    return false;
+  }
+  uint64_t time = 0;
+  for (int i = 8; i < 16; i++) {
+    time = (time << 8) | buf[i];
+  }
+  return schedule(time, buf, size);
+}
+
+bool OSCScheduler::schedule(uint64_t time, const uint8_t *buf, int size) {
+  memoryErr_ = false;
+  if (!ensureCapacity(size_ + 1)) {
+    return false;
+  }
+  Entry &e = heap_[size_];
+  e.time = time;
+  e.seq = nextSeq_++;
+  e.size = size;
+  e.buf = buf;
+  siftUp(size_++);
+  return true;
+}
+
+int OSCScheduler::poll(uint64_t now) {
+  int count = 0;
+  while (size_ > 0 &&
+         (heap_[0].time <= now || heap_[0].time == kImmediately)) {
+    // Remove it before calling the handler, which may schedule more
+    Entry e = heap_[0];
+    if (--size_ > 0) {
+      heap_[0] = heap_[size_];
+      siftDown(0);
+    }
+    if (handler_ != nullptr) {
+      handler_(e.buf, e.size, e.time, context_);
+    }
+    count++;
+  }
+  return count;
+}
+
+bool OSCScheduler::getNextTime(uint64_t *time) const {
+  if (size_ == 0) {
+    return false;
+  }
+  *time = heap_[0].time;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+//  Private functions
+// --------------------------------------------------------------------------
+
+void OSCScheduler::siftUp(int index) {
+  Entry e = heap_[index];
+  while (index > 0) {
+    int parent = (index - 1) >> 2;
+    if (!before(e, heap_[parent])) {
+      break;
+    }
+    heap_[index] = heap_[parent];
+    index = parent;
+  }
+  heap_[index] = e;
+}
+
+void OSCScheduler::siftDown(int index) {
+  Entry e = heap_[index];
+  while (true) {
+    int first = 4*index + 1;
+    if (first >= size_) {
+      break;
+    }
+    int last = (first + 4 < size_) ? first + 4 : size_;  // Exclusive
+    int best = first;
+    for (int c = first + 1; c < last; c++) {
+      if (before(heap_[c], heap_[best])) {
+        best = c;
+      }
+    }
+    if (!before(heap_[best], e)) {
+      break;
+    }
+    heap_[index] = heap_[best];
+    index = best;
+  }
+  heap_[index] = e;
+}
+
+bool OSCScheduler::ensureCapacity(int size) {
+  if (size <= capacity_) {
+    return true;
+  }
+  if (!dynamic_) {
+    memoryErr_ = true;
+    return false;
+  }
+
+  // Grow by half again, falling back to the exact size
+  int newCapacity = capacity_ + capacity_/2;
+  if (newCapacity < size) {
+    newCapacity = size;
+  }
+  Entry *p = static_cast<Entry *>(allocator_->reallocate(
+      heap_, capacity_ * sizeof(Entry), newCapacity * sizeof(Entry)));
+  if (p == nullptr && newCapacity != size) {
+    newCapacity = size;
+    p = static_cast<Entry *>(allocator_->reallocate(
+        heap_, capacity_ * sizeof(Entry), newCapacity * sizeof(Entry)));
+  }
+  if (p == nullptr) {
+    memoryErr_ = true;
+    return false;
+  }
+  heap_ = p;
+  capacity_ = newCapacity;
+  return true;
+}
+
+}  // namespace osc
+}  // namespace qindesign
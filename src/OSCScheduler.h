@@ -0,0 +1,143 @@
+// OSCScheduler.h defines a queue of bundles ordered by time.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCSCHEDULER_H_
+#define OSCSCHEDULER_H_
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstdint>)
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+#else
+#include <cstdint>
+#endif
+
+// Project includes
+#include "OSCAllocator.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCScheduledHandler is called by OSCScheduler when a bundle is due. buf
+// and size are what was scheduled, time is its time tag, and context is
+// whatever was given to the scheduler.
+using OSCScheduledHandler = void (*)(const uint8_t *buf, int size,
+                                     uint64_t time, void *context);
+
+// OSCScheduler holds received bundles until their time tags come due.
+// poll() passes every due bundle to the handler, earliest first; bundles
+// having the same time are passed in the order they were scheduled. The
+// time tag 1, which means "immediately", is always due.
+//
+// Only a pointer and size are kept for each bundle, so the data must
+// remain valid until it's passed to the handler. The handler can then
+// release it, for example back to an OSCPoolAllocator. The contents can
+// be read with an OSCBundleReader.
+//
+// The bundles are kept in a 4-ary heap, so scheduling and removing each
+// take O(log n) time, with fewer levels, and so fewer cache misses, than
+// a binary heap. Like the other classes, the heap can have a fixed
+// capacity, in which case it's allocated once up front, or it can be
+// dynamically allocated as needed.
+class OSCScheduler {
+ public:
+  // Creates a new scheduler. If capacity is positive then it limits the
+  // number of pending bundles, and all the memory is allocated now.
+  // Otherwise, memory is allocated as needed. Due bundles are passed to
+  // the handler along with the context.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCScheduler(int capacity, OSCScheduledHandler handler, void *context,
+               OSCAllocator *allocator = nullptr);
+
+  // Not copyable
+  OSCScheduler(const OSCScheduler &) = delete;
+  OSCScheduler &operator=(const OSCScheduler &) = delete;
+
+  ~OSCScheduler();
+
+  // Returns whether there wasn't enough room for the last bundle.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Returns the number of pending bundles.
+  int size() const {
+    return size_;
+  }
+
+  // Returns the number of bundles that can be pending without allocating.
+  int capacity() const {
+    return capacity_;
+  }
+
+  // Schedules a bundle using its own time tag. This returns false if the
+  // data isn't a bundle or if there isn't enough room.
+  bool schedule(const uint8_t *buf, int size);
+
+  // Schedules any data for the given time. This returns false if there
+  // isn't enough room.
+  bool schedule(uint64_t time, const uint8_t *buf, int size);
+
+  // Passes every bundle whose time is at or before 'now' to the handler
+  // and returns how many there were. The handler may schedule more
+  // bundles; any that are already due are passed on before this returns.
+  int poll(uint64_t now);
+
+  // Gets the time of the earliest pending bundle. This returns false if
+  // there are none.
+  bool getNextTime(uint64_t *time) const;
+
+  // Removes all the pending bundles without passing them to the handler.
+  void clear() {
+    size_ = 0;
+  }
+
+ private:
+  struct Entry {
+    uint64_t time;
+    uint32_t seq;  // Keeps the order for equal times
+    int size;
+    const uint8_t *buf;
+  };
+
+  // Returns whether a comes before b. Sequence numbers are compared so
+  // that wrapping around doesn't matter.
+  static bool before(const Entry &a, const Entry &b) {
+    if (a.time != b.time) {
+      return a.time < b.time;
+    }
+    return static_cast<int32_t>(a.seq - b.seq) < 0;
+  }
+
+  // Moves the entry at the given index up or down to its place.
+  void siftUp(int index);
+  void siftDown(int index);
+
+  // Ensures that we have room for the given number of entries. This
+  // returns whether we do, allocating if necessary. If there isn't
+  // enough space then the memory error condition will be set to 'true'.
+  bool ensureCapacity(int size);
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  Entry *heap_;
+  int size_;
+  int capacity_;
+  bool dynamic_;
+  uint32_t nextSeq_;
+
+  OSCScheduledHandler handler_;
+  void *context_;
+};
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCSCHEDULER_H_
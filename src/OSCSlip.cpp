@@ -0,0 +1,301 @@
+// OSCSlip.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCSlip.h"
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstring>)
+#include <cstring>
+#else
+#include <string.h>
+#endif
+#else
+#include <cstring>
+#endif
+
+// Vector includes, for scanning
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace qindesign {
+namespace osc {
+
+// Returns the index of the first END or ESC byte at or after 'off', or
+// 'len' if there isn't one.
+static int findSpecial(const uint8_t *buf, int off, int len) {
+#if defined(__SSE2__)
+  const __m128i ends = _mm_set1_epi8(static_cast<char>(OSCSlipEncoder::kEnd));
+  const __m128i escs = _mm_set1_epi8(static_cast<char>(OSCSlipEncoder::kEsc));
+  while (off + 16 <= len) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&buf[off]));
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(v, ends), _mm_cmpeq_epi8(v, escs)));
+    if (mask != 0) {
+      return off + __builtin_ctz(mask);
+    }
+    off += 16;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t ends = vdupq_n_u8(OSCSlipEncoder::kEnd);
+  const uint8x16_t escs = vdupq_n_u8(OSCSlipEncoder::kEsc);
+  while (off + 16 <= len) {
+    uint8x16_t v = vld1q_u8(&buf[off]);
+    if (vmaxvq_u8(vorrq_u8(vceqq_u8(v, ends), vceqq_u8(v, escs))) != 0) {
+      break;
+    }
+    off += 16;
+  }
+#endif
+
+#if !defined(__AVR__) && !defined(__ARM_ARCH_6M__)
+  // Word at a time; skipped where unaligned 32-bit loads are slow
+  while (off + 4 <= len) {
+    uint32_t w;
+    memcpy(&w, &buf[off], 4);
+    // A byte matches when it's zero after the XOR
+    uint32_t e = w ^ (uint32_t{OSCSlipEncoder::kEnd} * 0x01010101u);
+    uint32_t s = w ^ (uint32_t{OSCSlipEncoder::kEsc} * 0x01010101u);
+    if ((((e - 0x01010101u) & ~e) | ((s - 0x01010101u) & ~s)) &
+        0x80808080u) {
+      break;
+    }
+    off += 4;
+  }
+#endif
+
+  while (off < len) {
+    if (buf[off] == OSCSlipEncoder::kEnd || buf[off] == OSCSlipEncoder::kEsc) {
+      return off;
+    }
+    off++;
+  }
+  return len;
+}
+
+// --------------------------------------------------------------------------
+//  OSCSlipEncoder
+// --------------------------------------------------------------------------
+
+int OSCSlipEncoder::encodedSize(const uint8_t *buf, int len) {
+  int size = len + 2;
+  int i = findSpecial(buf, 0, len);
+  while (i < len) {
+    size++;
+    i = findSpecial(buf, i + 1, len);
+  }
+  return size;
+}
+
+int OSCSlipEncoder::encode(const uint8_t *buf, int len, uint8_t *out,
+                           int outSize) {
+  if (outSize < 1) {
+    return -1;
+  }
+  int n = 0;
+  out[n++] = kEnd;
+  int i = 0;
+  while (i < len) {
+    int run = findSpecial(buf, i, len);
+    if (run - i > outSize - n) {
+      return -1;
+    }
+    memcpy(&out[n], &buf[i], run - i);
+    n += run - i;
+    i = run;
+    if (i < len) {
+      if (outSize - n < 2) {
+        return -1;
+      }
+      out[n++] = kEsc;
+      out[n++] = (buf[i] == kEnd) ? kEscEnd : kEscEsc;
+      i++;
+    }
+  }
+  if (outSize - n < 1) {
+    return -1;
+  }
+  out[n++] = kEnd;
+  return n;
+}
+
+bool OSCSlipEncoder::encode(const uint8_t *buf, int len, OSCSlipWriter writer,
+                            void *context) {
+  static const uint8_t end[1]{kEnd};
+  static const uint8_t escEnd[2]{kEsc, kEscEnd};
+  static const uint8_t escEsc[2]{kEsc, kEscEsc};
+
+  if (!writer(end, 1, context)) {
+    return false;
+  }
+  int i = 0;
+  while (i < len) {
+    int run = findSpecial(buf, i, len);
+    if (run > i && !writer(&buf[i], run - i, context)) {
+      return false;
+    }
+    i = run;
+    if (i < len) {
+      if (!writer((buf[i] == kEnd) ? escEnd : escEsc, 2, context)) {
+        return false;
+      }
+      i++;
+    }
+  }
+  return writer(end, 1, context);
+}
+
+// --------------------------------------------------------------------------
+//  OSCSlipDecoder
+// --------------------------------------------------------------------------
+
+OSCSlipDecoder::OSCSlipDecoder(int maxPacketSize, OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      buf_(nullptr),
+      size_(0),
+      capacity_(0),
+      dynamic_(true),
+      ready_(false),
+      escaped_(false),
+      skipping_(false),
+      droppedCount_(0) {
+  if (maxPacketSize > 0) {
+    dynamic_ = false;
+    buf_ = static_cast<uint8_t *>(allocator_->allocate(maxPacketSize));
+    if (buf_ == nullptr) {
+      memoryErr_ = true;
+    } else {
+      capacity_ = maxPacketSize;
+    }
+  }
+}
+
+OSCSlipDecoder::~OSCSlipDecoder() {
+  allocator_->deallocate(buf_, capacity_);
+}
+
+void OSCSlipDecoder::reset() {
+  size_ = 0;
+  ready_ = false;
+  escaped_ = false;
+  skipping_ = false;
+}
+
+int OSCSlipDecoder::decode(const uint8_t *data, int len) {
+  if (ready_) {
+    ready_ = false;
+    size_ = 0;
+  }
+
+  int i = 0;
+  while (i < len) {
+    if (escaped_) {
+      escaped_ = false;
+      uint8_t c = data[i];
+      if (c == OSCSlipEncoder::kEnd) {
+        // A bad escape; leave the END to finish the frame
+        if (!skipping_) {
+          drop();
+        }
+        continue;
+      }
+      i++;
+      if (skipping_) {
+        continue;
+      }
+      if (c == OSCSlipEncoder::kEscEnd) {
+        c = OSCSlipEncoder::kEnd;
+      } else if (c == OSCSlipEncoder::kEscEsc) {
+        c = OSCSlipEncoder::kEsc;
+      } else {
+        drop();
+        continue;
+      }
+      append(&c, 1);
+      continue;
+    }
+
+    // Copy everything up to the next special byte in one go
+    int run = findSpecial(data, i, len);
+    if (run > i) {
+      if (!skipping_) {
+        append(&data[i], run - i);
+      }
+      i = run;
+      if (i >= len) {
+        break;
+      }
+    }
+
+    if (data[i++] == OSCSlipEncoder::kEsc) {
+      escaped_ = true;
+      continue;
+    }
+
+    // The end of a frame
+    if (skipping_) {
+      skipping_ = false;
+      size_ = 0;
+    } else if (size_ > 0) {
+      ready_ = true;
+      return i;
+    }
+  }
+  return i;
+}
+
+// --------------------------------------------------------------------------
+//  Private functions
+// --------------------------------------------------------------------------
+
+void OSCSlipDecoder::append(const uint8_t *data, int len) {
+  if (!ensureCapacity(size_ + len)) {
+    drop();
+    return;
+  }
+  memcpy(&buf_[size_], data, len);
+  size_ += len;
+}
+
+void OSCSlipDecoder::drop() {
+  droppedCount_++;
+  skipping_ = true;
+  size_ = 0;
+}
+
+bool OSCSlipDecoder::ensureCapacity(int size) {
+  if (size <= capacity_) {
+    return true;
+  }
+  if (!dynamic_) {
+    return false;
+  }
+
+  // Grow by half again so that long packets don't reallocate every
+  // chunk, but fall back to the exact size if that much isn't available
+  int newCapacity = capacity_ + capacity_/2;
+  if (newCapacity < size) {
+    newCapacity = size;
+  }
+  uint8_t *p = static_cast<uint8_t *>(
+      allocator_->reallocate(buf_, capacity_, newCapacity));
+  if (p == nullptr && newCapacity != size) {
+    newCapacity = size;
+    p = static_cast<uint8_t *>(
+        allocator_->reallocate(buf_, capacity_, newCapacity));
+  }
+  if (p == nullptr) {
+    memoryErr_ = true;
+    return false;
+  }
+  buf_ = p;
+  capacity_ = newCapacity;
+  return true;
+}
+
+}  // namespace osc
+}  // namespace qindesign
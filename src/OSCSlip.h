@@ -0,0 +1,163 @@
+// OSCSlip.h defines SLIP framing for OSC packets sent over streams.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCSLIP_H_
+#define OSCSLIP_H_
+
+// C++ includes
+#ifdef __has_include
+#if __has_include(<cstdint>)
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+#else
+#include <cstdint>
+#endif
+
+// Project includes
+#include "OSCAllocator.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCSlipWriter is called by OSCSlipEncoder with each piece of an encoded
+// packet, in order. It returns whether all the bytes were written.
+// context is whatever was given to the encoder.
+using OSCSlipWriter = bool (*)(const uint8_t *data, int len, void *context);
+
+// OSCSlipEncoder frames packets with SLIP (RFC 1055), as OSC 1.1 specifies
+// for stream transports such as TCP and serial links. Each packet is
+// preceded and followed by an END byte, and any END or ESC bytes inside it
+// are escaped.
+//
+// Most bytes in an OSC packet need no escaping, so the input is searched
+// for special bytes a vector or a word at a time, and the runs between
+// them are copied, or written, as a whole.
+class OSCSlipEncoder {
+ public:
+  static constexpr uint8_t kEnd = 0xc0;
+  static constexpr uint8_t kEsc = 0xdb;
+  static constexpr uint8_t kEscEnd = 0xdc;
+  static constexpr uint8_t kEscEsc = 0xdd;
+
+  // Returns the size of the given packet once encoded, including both END
+  // bytes.
+  static int encodedSize(const uint8_t *buf, int len);
+
+  // Encodes a packet into 'out', which has room for outSize bytes. This
+  // returns the encoded size, or -1 if there isn't enough room.
+  static int encode(const uint8_t *buf, int len, uint8_t *out, int outSize);
+
+  // Encodes a packet by passing the pieces to the writer. Runs of bytes
+  // that need no escaping are passed straight from 'buf', so nothing is
+  // copied. This returns whether the writer accepted everything.
+  static bool encode(const uint8_t *buf, int len, OSCSlipWriter writer,
+                     void *context);
+};
+
+// OSCSlipDecoder pulls SLIP-framed packets out of a byte stream that
+// arrives in chunks of any size, for example from a socket or a serial
+// port. Each packet is collected into a reusable buffer.
+//
+// Call decode() with each chunk. It stops just after the end of a packet,
+// so that the packet can be used before the rest of the chunk is decoded:
+//
+//   while (len > 0) {
+//     int n = decoder.decode(data, len);
+//     data += n;
+//     len -= n;
+//     if (decoder.isPacketReady()) {
+//       osc.parse(decoder.getPacket(), decoder.getPacketSize());
+//     }
+//   }
+//
+// Empty frames are skipped. A packet that's too large, that can't be
+// stored, or that has a bad escape sequence is dropped and counted.
+class OSCSlipDecoder {
+ public:
+  // Creates a new decoder. If maxPacketSize is positive then packets are
+  // limited to that size and the buffer is allocated up front. Otherwise,
+  // the buffer is dynamically allocated as needed.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCSlipDecoder(int maxPacketSize, OSCAllocator *allocator = nullptr);
+
+  // Creates a new decoder that allocates as needed.
+  OSCSlipDecoder() : OSCSlipDecoder(0) {}
+
+  // Not copyable
+  OSCSlipDecoder(const OSCSlipDecoder &) = delete;
+  OSCSlipDecoder &operator=(const OSCSlipDecoder &) = delete;
+
+  ~OSCSlipDecoder();
+
+  // Returns whether a buffer couldn't be allocated.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Decodes bytes from the stream until the end of a packet or the end of
+  // the data, and returns how many bytes were used. Any packet that was
+  // ready is forgotten first.
+  int decode(const uint8_t *data, int len);
+
+  // Returns whether the last call to decode() finished a packet.
+  bool isPacketReady() const {
+    return ready_;
+  }
+
+  // Returns the finished packet. This is valid until the next call to
+  // decode() or reset().
+  const uint8_t *getPacket() const {
+    return buf_;
+  }
+
+  // Returns the size of the finished packet, or of the partial packet
+  // collected so far.
+  int getPacketSize() const {
+    return size_;
+  }
+
+  // Returns the number of packets dropped because they were too large or
+  // had a bad escape sequence.
+  uint32_t getDroppedCount() const {
+    return droppedCount_;
+  }
+
+  // Forgets any partial or finished packet, for example after the stream
+  // is reconnected.
+  void reset();
+
+ private:
+  // Appends bytes to the packet, dropping it if there isn't room.
+  void append(const uint8_t *data, int len);
+
+  // Drops the current packet; the rest of it, up to the next END, is
+  // skipped.
+  void drop();
+
+  // Ensures that the buffer can hold the given number of bytes. This
+  // returns whether it can, allocating if necessary.
+  bool ensureCapacity(int size);
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  uint8_t *buf_;
+  int size_;
+  int capacity_;
+  bool dynamic_;
+
+  bool ready_;     // Whether buf_ holds a finished packet
+  bool escaped_;   // Whether the last byte was an ESC
+  bool skipping_;  // Whether a dropped packet is being skipped
+  uint32_t droppedCount_;
+};
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCSLIP_H_
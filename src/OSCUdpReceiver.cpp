@@ -0,0 +1,199 @@
+// OSCUdpReceiver.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCUdpReceiver.h"
+
+#if defined(__linux__)
+
+// C++ includes
+#include <cerrno>
+#include <cstring>
+
+// Other includes
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+namespace qindesign {
+namespace osc {
+
+OSCUdpReceiver::OSCUdpReceiver(int batchSize, int maxDatagramSize,
+                               int maxArgs, OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      fd_(-1),
+      ownsFd_(false),
+      batchSize_((batchSize < 1) ? 1 : batchSize),
+      datagramSize_(0),
+      slab_(nullptr),
+      msgs_(nullptr),
+      iovs_(nullptr),
+      addrs_(nullptr),
+      view_(maxArgs, allocator),
+      messageHandler_(nullptr),
+      messageContext_(nullptr),
+      bundleHandler_(nullptr),
+      bundleContext_(nullptr),
+      datagramCount_(0),
+      invalidCount_(0),
+      callCount_(0) {
+  // Keep each datagram aligned
+  if (maxDatagramSize < 16) {
+    maxDatagramSize = 16;
+  }
+  datagramSize_ = (maxDatagramSize + 7) & ~7;
+
+  slab_ = static_cast<uint8_t *>(
+      allocator_->allocate(batchSize_ * datagramSize_));
+  msgs_ = static_cast<struct mmsghdr *>(
+      allocator_->allocate(batchSize_ * sizeof(struct mmsghdr)));
+  iovs_ = static_cast<struct iovec *>(
+      allocator_->allocate(batchSize_ * sizeof(struct iovec)));
+  addrs_ = static_cast<struct sockaddr_storage *>(
+      allocator_->allocate(batchSize_ * sizeof(struct sockaddr_storage)));
+  if (slab_ == nullptr || msgs_ == nullptr || iovs_ == nullptr ||
+      addrs_ == nullptr || view_.isMemoryError()) {
+    memoryErr_ = true;
+    return;
+  }
+
+  // Everything but the address lengths stays the same between calls
+  memset(msgs_, 0, batchSize_ * sizeof(struct mmsghdr));
+  for (int i = 0; i < batchSize_; i++) {
+    iovs_[i].iov_base = &slab_[i * datagramSize_];
+    iovs_[i].iov_len = datagramSize_;
+    msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+    msgs_[i].msg_hdr.msg_iovlen = 1;
+    msgs_[i].msg_hdr.msg_name = &addrs_[i];
+  }
+}
+
+OSCUdpReceiver::~OSCUdpReceiver() {
+  close();
+  allocator_->deallocate(addrs_, batchSize_ * sizeof(struct sockaddr_storage));
+  allocator_->deallocate(iovs_, batchSize_ * sizeof(struct iovec));
+  allocator_->deallocate(msgs_, batchSize_ * sizeof(struct mmsghdr));
+  allocator_->deallocate(slab_, batchSize_ * datagramSize_);
+}
+
+bool OSCUdpReceiver::open(uint16_t port, const char *address) {
+  close();
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (address != nullptr && inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+    errno = EINVAL;
+    return false;
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return false;
+  }
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) !=
+      0) {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return false;
+  }
+  fd_ = fd;
+  ownsFd_ = true;
+  return true;
+}
+
+void OSCUdpReceiver::setSocket(int fd) {
+  close();
+  fd_ = fd;
+  ownsFd_ = false;
+}
+
+uint16_t OSCUdpReceiver::getPort() const {
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  if (fd_ < 0 ||
+      getsockname(fd_, reinterpret_cast<struct sockaddr *>(&addr), &len) !=
+          0) {
+    return 0;
+  }
+  if (addr.ss_family == AF_INET) {
+    return ntohs(reinterpret_cast<struct sockaddr_in *>(&addr)->sin_port);
+  }
+  if (addr.ss_family == AF_INET6) {
+    return ntohs(reinterpret_cast<struct sockaddr_in6 *>(&addr)->sin6_port);
+  }
+  return 0;
+}
+
+void OSCUdpReceiver::close() {
+  if (fd_ >= 0 && ownsFd_) {
+    ::close(fd_);
+  }
+  fd_ = -1;
+  ownsFd_ = false;
+}
+
+int OSCUdpReceiver::receive(bool wait) {
+  if (fd_ < 0 || memoryErr_) {
+    errno = EBADF;
+    return -1;
+  }
+  for (int i = 0; i < batchSize_; i++) {
+    msgs_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+  }
+
+  // MSG_WAITFORONE blocks only until the first datagram
+  int n = recvmmsg(fd_, msgs_, batchSize_,
+                   wait ? MSG_WAITFORONE : MSG_DONTWAIT, nullptr);
+  callCount_++;
+  if (n < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    return -1;
+  }
+  for (int i = 0; i < n; i++) {
+    handleDatagram(&slab_[i * datagramSize_], msgs_[i].msg_len,
+                   (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0,
+                   reinterpret_cast<const sockaddr *>(&addrs_[i]));
+  }
+  return n;
+}
+
+// --------------------------------------------------------------------------
+//  Private functions
+// --------------------------------------------------------------------------
+
+void OSCUdpReceiver::handleDatagram(const uint8_t *data, int len,
+                                    bool truncated, const sockaddr *from) {
+  // Only this thread writes the count, so it needn't be a locked increment
+  datagramCount_.store(datagramCount_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+  if (truncated || len <= 0) {
+    invalidCount_++;
+    return;
+  }
+  if (data[0] == '/') {
+    if (!view_.parse(data, len)) {
+      invalidCount_++;
+    } else if (messageHandler_ != nullptr) {
+      messageHandler_(view_, from, messageContext_);
+    }
+    return;
+  }
+  if (!validator_.validate(data, len) || !reader_.init(data, len)) {
+    invalidCount_++;
+    return;
+  }
+  if (bundleHandler_ != nullptr) {
+    bundleHandler_(reader_, from, bundleContext_);
+  }
+}
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // __linux__
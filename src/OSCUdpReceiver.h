@@ -0,0 +1,167 @@
+// OSCUdpReceiver.h defines a batched UDP receiver for Linux.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCUDPRECEIVER_H_
+#define OSCUDPRECEIVER_H_
+
+// This uses recvmmsg, which is specific to Linux
+#if defined(__linux__)
+
+// C++ includes
+#include <atomic>
+#include <cstdint>
+
+// Other includes
+#include <sys/socket.h>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCAllocator.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCUdpMessageHandler is called by OSCUdpReceiver for each received
+// message. The message and the sender's address, from, are only valid
+// until the handler returns.
+using OSCUdpMessageHandler = void (*)(const OSCMessageView &msg,
+                                      const sockaddr *from, void *context);
+
+// OSCUdpBundleHandler is called by OSCUdpReceiver for each received
+// bundle, which has already been checked with an OSCBundleValidator. The
+// bundle and the sender's address are only valid until the handler
+// returns.
+using OSCUdpBundleHandler = void (*)(const OSCBundleReader &bundle,
+                                     const sockaddr *from, void *context);
+
+// OSCUdpReceiver receives OSC packets from a UDP socket, up to a batch of
+// them per recvmmsg call, into a slab of memory allocated up front. Each
+// datagram is then parsed in place and passed to the message handler or,
+// if it starts with "#bundle", to the bundle handler. Nothing is copied
+// or allocated per packet, as long as the maximum argument count is
+// positive.
+//
+// This is only available on Linux.
+class OSCUdpReceiver {
+ public:
+  // Creates a receiver that gets up to batchSize datagrams per call, each
+  // up to maxDatagramSize bytes. Larger datagrams are truncated by the
+  // system and counted as invalid.
+  //
+  // If maxArgs is positive then room for that many message arguments is
+  // allocated up front, and a message having more is counted as invalid.
+  // Otherwise, the room is allocated while receiving, as needed.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCUdpReceiver(int batchSize, int maxDatagramSize, int maxArgs,
+                 OSCAllocator *allocator = nullptr);
+
+  // Not copyable
+  OSCUdpReceiver(const OSCUdpReceiver &) = delete;
+  OSCUdpReceiver &operator=(const OSCUdpReceiver &) = delete;
+
+  // Closes the socket if it was opened by this object.
+  ~OSCUdpReceiver();
+
+  // Returns whether the buffers couldn't be allocated.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Opens an IPv4 UDP socket bound to the given port and, optionally, to
+  // the given local address; otherwise to all addresses. A port of zero
+  // picks any free port; see getPort(). This returns whether successful,
+  // and errno is set if not.
+  bool open(uint16_t port, const char *address = nullptr);
+
+  // Uses an already open socket. This object won't close it.
+  void setSocket(int fd);
+
+  // Returns the socket, or -1 if there isn't one.
+  int getSocket() const {
+    return fd_;
+  }
+
+  // Returns the local port the socket is bound to, or zero if unknown.
+  uint16_t getPort() const;
+
+  // Closes the socket if it was opened by this object, and forgets it.
+  void close();
+
+  // Sets the handler for messages.
+  void setMessageHandler(OSCUdpMessageHandler handler, void *context) {
+    messageHandler_ = handler;
+    messageContext_ = context;
+  }
+
+  // Sets the handler for bundles.
+  void setBundleHandler(OSCUdpBundleHandler handler, void *context) {
+    bundleHandler_ = handler;
+    bundleContext_ = context;
+  }
+
+  // Receives one batch of datagrams with a single system call and passes
+  // each one to its handler. If 'wait' is true then this blocks until at
+  // least one datagram arrives; otherwise it returns immediately. This
+  // returns the number of datagrams received, or -1 on error, in which
+  // case errno is set.
+  int receive(bool wait);
+
+  // Returns the number of datagrams received so far. Unlike the other
+  // counters, this may be read from another thread while receiving, for
+  // example to watch a server's progress.
+  uint64_t getDatagramCount() const {
+    return datagramCount_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the number of received datagrams that were truncated, weren't
+  // a valid message or bundle, or had too many arguments.
+  uint64_t getInvalidCount() const {
+    return invalidCount_;
+  }
+
+  // Returns the number of recvmmsg calls so far.
+  uint64_t getCallCount() const {
+    return callCount_;
+  }
+
+ private:
+  // Parses one datagram and passes it on.
+  void handleDatagram(const uint8_t *data, int len, bool truncated,
+                      const sockaddr *from);
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  int fd_;
+  bool ownsFd_;
+
+  int batchSize_;
+  int datagramSize_;  // Rounded up for alignment
+  uint8_t *slab_;
+  struct mmsghdr *msgs_;
+  struct iovec *iovs_;
+  struct sockaddr_storage *addrs_;
+
+  OSCMessageView view_;
+  OSCBundleReader reader_;
+  OSCBundleValidator validator_;
+
+  OSCUdpMessageHandler messageHandler_;
+  void *messageContext_;
+  OSCUdpBundleHandler bundleHandler_;
+  void *bundleContext_;
+
+  std::atomic<uint64_t> datagramCount_;
+  uint64_t invalidCount_;
+  uint64_t callCount_;
+};
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // __linux__
+
+#endif  // OSCUDPRECEIVER_H_
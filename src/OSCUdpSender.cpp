@@ -0,0 +1,244 @@
+// OSCUdpSender.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCUdpSender.h"
+
+#if defined(__linux__)
+
+// C++ includes
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+// Other includes
+#include <netinet/in.h>
+#include <unistd.h>
+
+namespace qindesign {
+namespace osc {
+
+OSCUdpSender::OSCUdpSender(int slotCount, int slotSize,
+                           OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      fd_(-1),
+      ownsFd_(false),
+      slotCount_((slotCount < 1) ? 1 : slotCount),
+      slotSize_((slotSize < 0) ? 0 : slotSize),
+      stride_(0),
+      slab_(nullptr),
+      msgs_(nullptr),
+      iovs_(nullptr),
+      addrs_(nullptr),
+      head_(0),
+      count_(0),
+      threshold_(0),
+      maxDelay_(0),
+      firstTime_(0),
+      queuedCount_(0),
+      sentCount_(0),
+      droppedCount_(0),
+      callCount_(0) {
+  threshold_ = slotCount_;
+
+  // Keep each slot aligned
+  stride_ = (slotSize_ + 7) & ~7;
+
+  if (stride_ > 0) {
+    slab_ = static_cast<uint8_t *>(
+        allocator_->allocate(slotCount_ * stride_));
+  }
+  msgs_ = static_cast<struct mmsghdr *>(
+      allocator_->allocate(slotCount_ * sizeof(struct mmsghdr)));
+  iovs_ = static_cast<struct iovec *>(
+      allocator_->allocate(slotCount_ * sizeof(struct iovec)));
+  addrs_ = static_cast<struct sockaddr_storage *>(
+      allocator_->allocate(slotCount_ * sizeof(struct sockaddr_storage)));
+  if ((stride_ > 0 && slab_ == nullptr) || msgs_ == nullptr ||
+      iovs_ == nullptr || addrs_ == nullptr) {
+    memoryErr_ = true;
+    return;
+  }
+
+  // Only the data, its size, and the address length change per packet
+  memset(msgs_, 0, slotCount_ * sizeof(struct mmsghdr));
+  for (int i = 0; i < slotCount_; i++) {
+    msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+    msgs_[i].msg_hdr.msg_iovlen = 1;
+    msgs_[i].msg_hdr.msg_name = &addrs_[i];
+  }
+}
+
+OSCUdpSender::~OSCUdpSender() {
+  close();
+  allocator_->deallocate(addrs_,
+                         slotCount_ * sizeof(struct sockaddr_storage));
+  allocator_->deallocate(iovs_, slotCount_ * sizeof(struct iovec));
+  allocator_->deallocate(msgs_, slotCount_ * sizeof(struct mmsghdr));
+  allocator_->deallocate(slab_, slotCount_ * stride_);
+}
+
+bool OSCUdpSender::open() {
+  close();
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return false;
+  }
+  fd_ = fd;
+  ownsFd_ = true;
+  return true;
+}
+
+void OSCUdpSender::setSocket(int fd) {
+  close();
+  fd_ = fd;
+  ownsFd_ = false;
+}
+
+void OSCUdpSender::close() {
+  if (fd_ >= 0 && ownsFd_) {
+    ::close(fd_);
+  }
+  fd_ = -1;
+  ownsFd_ = false;
+}
+
+void OSCUdpSender::setFlushThreshold(int count) {
+  if (count < 1 || count > slotCount_) {
+    count = slotCount_;
+  }
+  threshold_ = count;
+}
+
+bool OSCUdpSender::queue(const uint8_t *buf, int size, const sockaddr *to,
+                         socklen_t toLen) {
+  if (size <= 0 || size > slotSize_) {
+    droppedCount_++;
+    return false;
+  }
+  int slot = claimSlot(to, toLen);
+  if (slot < 0) {
+    return false;
+  }
+  uint8_t *p = &slab_[slot * stride_];
+  memcpy(p, buf, size);
+  commitSlot(slot, p, size);
+  return true;
+}
+
+bool OSCUdpSender::queueRef(const uint8_t *buf, int size, const sockaddr *to,
+                            socklen_t toLen) {
+  if (size <= 0) {
+    droppedCount_++;
+    return false;
+  }
+  int slot = claimSlot(to, toLen);
+  if (slot < 0) {
+    return false;
+  }
+  commitSlot(slot, buf, size);
+  return true;
+}
+
+int OSCUdpSender::poll() {
+  if (count_ == 0) {
+    return 0;
+  }
+  if (maxDelay_ != 0 && nowMicros() - firstTime_ < maxDelay_) {
+    return 0;
+  }
+  int n = flush();
+  return (n < 0) ? 0 : n;
+}
+
+int OSCUdpSender::flush() {
+  if (fd_ < 0) {
+    return -1;
+  }
+
+  int sent = 0;
+  while (count_ > 0) {
+    // The pending slots wrap around at most once, so this takes at most
+    // two calls when nothing fails
+    int run = slotCount_ - head_;
+    if (run > count_) {
+      run = count_;
+    }
+    int n = sendmmsg(fd_, &msgs_[head_], run, 0);
+    callCount_++;
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        break;
+      }
+
+      // Only the first packet failed; drop it and carry on
+      n = 1;
+      droppedCount_++;
+    } else if (n == 0) {
+      break;
+    } else {
+      sent += n;
+      sentCount_ += n;
+    }
+    head_ += n;
+    if (head_ >= slotCount_) {
+      head_ -= slotCount_;
+    }
+    count_ -= n;
+  }
+  if (count_ == 0) {
+    head_ = 0;
+  }
+  return sent;
+}
+
+// --------------------------------------------------------------------------
+//  Private functions
+// --------------------------------------------------------------------------
+
+int OSCUdpSender::claimSlot(const sockaddr *to, socklen_t toLen) {
+  if (memoryErr_ || to == nullptr || toLen > sizeof(struct sockaddr_storage)) {
+    droppedCount_++;
+    return -1;
+  }
+  if (count_ >= slotCount_) {
+    flush();
+    if (count_ >= slotCount_) {
+      droppedCount_++;
+      return -1;
+    }
+  }
+  int slot = head_ + count_;
+  if (slot >= slotCount_) {
+    slot -= slotCount_;
+  }
+  memcpy(&addrs_[slot], to, toLen);
+  msgs_[slot].msg_hdr.msg_namelen = toLen;
+  return slot;
+}
+
+void OSCUdpSender::commitSlot(int slot, const uint8_t *buf, int size) {
+  // sendmmsg doesn't write through iov_base
+  iovs_[slot].iov_base = const_cast<uint8_t *>(buf);
+  iovs_[slot].iov_len = size;
+  if (count_ == 0) {
+    firstTime_ = nowMicros();
+  }
+  count_++;
+  queuedCount_++;
+  if (count_ >= threshold_) {
+    flush();
+  }
+}
+
+uint32_t OSCUdpSender::nowMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint32_t>(ts.tv_sec) * 1000000u +
+         static_cast<uint32_t>(ts.tv_nsec / 1000);
+}
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // __linux__
@@ -0,0 +1,235 @@
+// OSCUdpSender.h defines a batched UDP sender for Linux.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCUDPSENDER_H_
+#define OSCUDPSENDER_H_
+
+// This uses sendmmsg, which is specific to Linux
+#if defined(__linux__)
+
+// C++ includes
+#include <cstdint>
+
+// Other includes
+#include <sys/socket.h>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCAllocator.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCUdpSender queues outgoing packets in a fixed ring of slots and sends
+// all the queued ones with a single sendmmsg call. Each slot remembers
+// its own destination, so sending one update to many clients costs one
+// system call instead of one per client.
+//
+// A packet can be queued three ways: copied into a slot, referenced where
+// it is without copying, or encoded directly into a slot from an address
+// and arguments. A referenced packet must stay valid until it's sent, so
+// the same built message can be queued once per client for free.
+//
+// The queue is flushed when the number of pending packets reaches the
+// flush threshold, when poll() finds that the oldest pending packet has
+// waited longer than the maximum delay, or when flush() is called. If the
+// ring is full and can't be flushed, for example because the socket would
+// block, the new packet is dropped and counted.
+//
+// This is only available on Linux.
+class OSCUdpSender {
+ public:
+  // Creates a sender having slotCount slots, each of which can hold a
+  // copied or encoded packet of up to slotSize bytes. Referenced packets
+  // can be any size. Memory for the slots is allocated up front.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCUdpSender(int slotCount, int slotSize,
+               OSCAllocator *allocator = nullptr);
+
+  // Not copyable
+  OSCUdpSender(const OSCUdpSender &) = delete;
+  OSCUdpSender &operator=(const OSCUdpSender &) = delete;
+
+  // Closes the socket if it was opened by this object. Anything still
+  // pending is discarded.
+  ~OSCUdpSender();
+
+  // Returns whether the slots couldn't be allocated.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Opens an unbound IPv4 UDP socket. This returns whether successful,
+  // and errno is set if not.
+  bool open();
+
+  // Uses an already open socket. This object won't close it.
+  void setSocket(int fd);
+
+  // Returns the socket, or -1 if there isn't one.
+  int getSocket() const {
+    return fd_;
+  }
+
+  // Closes the socket if it was opened by this object, and forgets it.
+  // Anything still pending stays queued until the next flush with a
+  // socket.
+  void close();
+
+  // Returns the number of slots.
+  int getSlotCount() const {
+    return slotCount_;
+  }
+
+  // Returns the largest packet that can be copied or encoded into a slot.
+  int getSlotSize() const {
+    return slotSize_;
+  }
+
+  // Sets how many pending packets cause an automatic flush. Values
+  // outside 1 to the slot count mean the slot count, which is the
+  // default.
+  void setFlushThreshold(int count);
+
+  // Returns the flush threshold.
+  int getFlushThreshold() const {
+    return threshold_;
+  }
+
+  // Sets the longest time, in microseconds, that a packet may wait before
+  // poll() flushes it. Zero means that poll() flushes anything pending,
+  // which is the default.
+  void setMaxDelay(uint32_t micros) {
+    maxDelay_ = micros;
+  }
+
+  // Returns the maximum delay, in microseconds.
+  uint32_t getMaxDelay() const {
+    return maxDelay_;
+  }
+
+  // Copies a packet into a slot to be sent to the given destination. This
+  // returns whether it was queued.
+  bool queue(const uint8_t *buf, int size, const sockaddr *to,
+             socklen_t toLen);
+
+  // Queues a packet without copying it. The data must remain valid and
+  // unchanged until it's been sent, which is once getPendingCount()
+  // reaches zero. This returns whether it was queued.
+  bool queueRef(const uint8_t *buf, int size, const sockaddr *to,
+                socklen_t toLen);
+
+  // Encodes a message having the given address and arguments directly
+  // into a slot, in the same way as LiteOSCParser::build. This returns
+  // whether it was queued.
+  template <typename... Args>
+  bool queueMessage(const sockaddr *to, socklen_t toLen,
+                    const char *address, Args... args);
+
+  // Flushes if the oldest pending packet has waited at least the maximum
+  // delay. This returns the number of packets sent.
+  int poll();
+
+  // Sends everything pending, making as few system calls as possible.
+  // Packets that the system rejects are dropped. This stops early if the
+  // socket would block, leaving the rest pending. This returns the number
+  // of packets sent, or -1 if there's no socket.
+  int flush();
+
+  // Returns the number of packets waiting to be sent.
+  int getPendingCount() const {
+    return count_;
+  }
+
+  // Returns the number of packets queued so far.
+  uint64_t getQueuedCount() const {
+    return queuedCount_;
+  }
+
+  // Returns the number of packets sent so far.
+  uint64_t getSentCount() const {
+    return sentCount_;
+  }
+
+  // Returns the number of packets dropped so far, either because there
+  // wasn't room, they were too large, or the system rejected them.
+  uint64_t getDroppedCount() const {
+    return droppedCount_;
+  }
+
+  // Returns the number of sendmmsg calls so far.
+  uint64_t getCallCount() const {
+    return callCount_;
+  }
+
+ private:
+  // Finds a free slot, flushing if the ring is full, and fills in its
+  // destination. This returns the slot index, or -1 if there's no room or
+  // the destination is too large, in which case the drop is counted.
+  int claimSlot(const sockaddr *to, socklen_t toLen);
+
+  // Points the slot at its data and adds it to the pending packets,
+  // flushing if the threshold is reached.
+  void commitSlot(int slot, const uint8_t *buf, int size);
+
+  // Returns the current monotonic time in microseconds.
+  static uint32_t nowMicros();
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  int fd_;
+  bool ownsFd_;
+
+  int slotCount_;
+  int slotSize_;
+  int stride_;  // Slot size rounded up for alignment
+  uint8_t *slab_;
+  struct mmsghdr *msgs_;
+  struct iovec *iovs_;
+  struct sockaddr_storage *addrs_;
+
+  // The pending packets are the count_ slots starting at head_
+  int head_;
+  int count_;
+  int threshold_;
+  uint32_t maxDelay_;
+  uint32_t firstTime_;  // When the oldest pending packet was queued
+
+  uint64_t queuedCount_;
+  uint64_t sentCount_;
+  uint64_t droppedCount_;
+  uint64_t callCount_;
+};
+
+// --------------------------------------------------------------------------
+//  Template implementations
+// --------------------------------------------------------------------------
+
+template <typename... Args>
+bool OSCUdpSender::queueMessage(const sockaddr *to, socklen_t toLen,
+                                const char *address, Args... args) {
+  int size = LiteOSCParser::messageSize(address, args...);
+  if (size <= 0 || size > slotSize_) {
+    droppedCount_++;
+    return false;
+  }
+  int slot = claimSlot(to, toLen);
+  if (slot < 0) {
+    return false;
+  }
+  uint8_t *buf = &slab_[slot * stride_];
+  LiteOSCParser::buildMessage(buf, size, address, args...);
+  commitSlot(slot, buf, size);
+  return true;
+}
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // __linux__
+
+#endif  // OSCUDPSENDER_H_
@@ -0,0 +1,303 @@
+// OSCUdpServer.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#include "OSCUdpServer.h"
+
+#ifdef OSCUDPSERVER_AVAILABLE_
+
+// C++ includes
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+// Other includes
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Project includes
+#include "LiteOSCParser.h"
+
+namespace qindesign {
+namespace osc {
+
+// The FNV-1a prime, the same as used by OSCMessageView::hashAddress.
+static constexpr uint32_t kFnvPrime = 16777619u;
+
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+// Makes a classic BPF statement.
+static struct sock_filter bpfStmt(uint16_t code, uint32_t k) {
+  struct sock_filter f;
+  f.code = code;
+  f.jt = 0;
+  f.jf = 0;
+  f.k = k;
+  return f;
+}
+
+// Makes a classic BPF jump.
+static struct sock_filter bpfJump(uint16_t code, uint32_t k, uint8_t jt,
+                                  uint8_t jf) {
+  struct sock_filter f;
+  f.code = code;
+  f.jt = jt;
+  f.jf = jf;
+  f.k = k;
+  return f;
+}
+#endif  // SO_ATTACH_REUSEPORT_CBPF
+
+// Returns how many characters of the address make up the affinity prefix
+// having the given number of containers.
+static int affinityPrefixLen(const char *address, int depth) {
+  int slashes = 0;
+  int i = 0;
+  while (i < OSCUdpServer::kMaxAffinityLen && address[i] != '\0') {
+    if (address[i] == '/' && ++slashes > depth) {
+      break;
+    }
+    i++;
+  }
+  return i;
+}
+
+OSCUdpServer::OSCUdpServer(int workerCount, int batchSize,
+                           int maxDatagramSize, int maxArgs,
+                           OSCAllocator *allocator)
+    : allocator_(allocator != nullptr ? allocator : &OSCAllocator::heap()),
+      memoryErr_(false),
+      workerCount_((workerCount < 1) ? 1 : workerCount),
+      workers_(nullptr),
+      affinity_(0),
+      running_(false),
+      stopping_(false) {
+  workers_ = static_cast<Worker *>(
+      allocator_->allocate(workerCount_ * sizeof(Worker)));
+  if (workers_ == nullptr) {
+    memoryErr_ = true;
+    workerCount_ = 0;
+    return;
+  }
+  for (int i = 0; i < workerCount_; i++) {
+    new (&workers_[i]) Worker(batchSize, maxDatagramSize, maxArgs, allocator);
+    if (workers_[i].receiver.isMemoryError()) {
+      memoryErr_ = true;
+    }
+  }
+}
+
+OSCUdpServer::~OSCUdpServer() {
+  close();
+  for (int i = 0; i < workerCount_; i++) {
+    workers_[i].~Worker();
+  }
+  allocator_->deallocate(workers_, workerCount_ * sizeof(Worker));
+}
+
+void OSCUdpServer::setMessageHandler(OSCUdpMessageHandler handler,
+                                     void *context) {
+  for (int i = 0; i < workerCount_; i++) {
+    workers_[i].receiver.setMessageHandler(handler, context);
+  }
+}
+
+void OSCUdpServer::setBundleHandler(OSCUdpBundleHandler handler,
+                                    void *context) {
+  for (int i = 0; i < workerCount_; i++) {
+    workers_[i].receiver.setBundleHandler(handler, context);
+  }
+}
+
+int OSCUdpServer::getWorkerForAddress(const char *address) const {
+  if (affinity_ <= 0 || workerCount_ == 0) {
+    return -1;
+  }
+  uint32_t h = OSCMessageView::hashAddress(
+      address, affinityPrefixLen(address, affinity_));
+  return h % static_cast<uint32_t>(workerCount_);
+}
+
+bool OSCUdpServer::open(uint16_t port, const char *address) {
+  close();
+  if (memoryErr_) {
+    errno = ENOMEM;
+    return false;
+  }
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (address != nullptr && inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+    errno = EINVAL;
+    return false;
+  }
+
+  // A timeout lets a blocked worker notice that it should stop
+  struct timeval timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = kStopMillis * 1000;
+
+  for (int i = 0; i < workerCount_; i++) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+      break;
+    }
+    workers_[i].fd = fd;
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) !=
+            0 ||
+        bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) !=
+            0) {
+      break;
+    }
+
+    // The rest bind to whatever port the first one got
+    if (i == 0 && port == 0) {
+      socklen_t len = sizeof(addr);
+      if (getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len) !=
+          0) {
+        break;
+      }
+    }
+    workers_[i].receiver.setSocket(fd);
+  }
+  if (workers_[workerCount_ - 1].receiver.getSocket() < 0 ||
+      (affinity_ > 0 && !attachAffinity())) {
+    int err = errno;
+    close();
+    errno = err;
+    return false;
+  }
+  return true;
+}
+
+uint16_t OSCUdpServer::getPort() const {
+  if (workerCount_ == 0) {
+    return 0;
+  }
+  return workers_[0].receiver.getPort();
+}
+
+bool OSCUdpServer::start() {
+  if (running_ || workerCount_ == 0 || workers_[0].fd < 0) {
+    return false;
+  }
+  stopping_ = false;
+  for (int i = 0; i < workerCount_; i++) {
+    workers_[i].thread = std::thread(&OSCUdpServer::run, this, &workers_[i]);
+  }
+  running_ = true;
+  return true;
+}
+
+void OSCUdpServer::stop() {
+  if (!running_) {
+    return;
+  }
+  stopping_ = true;
+  for (int i = 0; i < workerCount_; i++) {
+    workers_[i].thread.join();
+  }
+  running_ = false;
+}
+
+void OSCUdpServer::close() {
+  stop();
+  for (int i = 0; i < workerCount_; i++) {
+    workers_[i].receiver.close();
+    if (workers_[i].fd >= 0) {
+      ::close(workers_[i].fd);
+      workers_[i].fd = -1;
+    }
+  }
+}
+
+uint64_t OSCUdpServer::getDatagramCount() const {
+  uint64_t count = 0;
+  for (int i = 0; i < workerCount_; i++) {
+    count += workers_[i].receiver.getDatagramCount();
+  }
+  return count;
+}
+
+// --------------------------------------------------------------------------
+//  Private functions
+// --------------------------------------------------------------------------
+
+void OSCUdpServer::run(Worker *worker) {
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    if (worker->receiver.receive(true) < 0 && errno != EINTR) {
+      break;
+    }
+  }
+}
+
+bool OSCUdpServer::attachAffinity() {
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  // The program sees the UDP payload. It hashes the address, a byte at a
+  // time, up to the NULL or the slash that ends the prefix, in the same
+  // way as getWorkerForAddress(), and returns the hash modulo the number
+  // of workers, which is the index of a socket in the group. Classic BPF
+  // can't loop, so there's one block per character. A read past the end
+  // of a short packet returns 0, the first worker.
+  //
+  // Scratch memory: M[0] is the hash and M[1] is the number of slashes.
+  static constexpr int kBlockLen = 16;  // Instructions per character
+  static constexpr int kProgLen = 4 + kMaxAffinityLen * kBlockLen + 3;
+  struct sock_filter prog[kProgLen];
+  const int done = kProgLen - 3;
+
+  int pc = 0;
+  prog[pc++] = bpfStmt(BPF_LD | BPF_IMM, OSCMessageView::hashAddress("", 0));
+  prog[pc++] = bpfStmt(BPF_ST, 0);
+  prog[pc++] = bpfStmt(BPF_LD | BPF_IMM, 0);
+  prog[pc++] = bpfStmt(BPF_ST, 1);
+  for (int i = 0; i < kMaxAffinityLen; i++) {
+    // Jumps are relative to the next instruction; the last instruction in
+    // each block jumps to the end
+    prog[pc++] = bpfStmt(BPF_LD | BPF_B | BPF_ABS, i);
+    prog[pc++] = bpfJump(BPF_JMP | BPF_JEQ | BPF_K, 0, 13, 0);
+    prog[pc++] = bpfJump(BPF_JMP | BPF_JEQ | BPF_K, '/', 0, 6);
+
+    // A slash: count it, and stop if it's past the prefix
+    prog[pc++] = bpfStmt(BPF_MISC | BPF_TAX, 0);
+    prog[pc++] = bpfStmt(BPF_LD | BPF_MEM, 1);
+    prog[pc++] = bpfStmt(BPF_ALU | BPF_ADD | BPF_K, 1);
+    prog[pc++] = bpfStmt(BPF_ST, 1);
+    prog[pc++] = bpfJump(BPF_JMP | BPF_JGT | BPF_K, affinity_, 7, 0);
+    prog[pc++] = bpfStmt(BPF_MISC | BPF_TXA, 0);
+
+    // Hash the character
+    prog[pc++] = bpfStmt(BPF_MISC | BPF_TAX, 0);
+    prog[pc++] = bpfStmt(BPF_LD | BPF_MEM, 0);
+    prog[pc++] = bpfStmt(BPF_ALU | BPF_XOR | BPF_X, 0);
+    prog[pc++] = bpfStmt(BPF_ALU | BPF_MUL | BPF_K, kFnvPrime);
+    prog[pc++] = bpfStmt(BPF_ST, 0);
+    prog[pc++] = bpfJump(BPF_JMP | BPF_JA, 1, 0, 0);
+    prog[pc] = bpfJump(BPF_JMP | BPF_JA, done - (pc + 1), 0, 0);
+    pc++;
+  }
+  prog[pc++] = bpfStmt(BPF_LD | BPF_MEM, 0);
+  prog[pc++] = bpfStmt(BPF_ALU | BPF_MOD | BPF_K, workerCount_);
+  prog[pc++] = bpfStmt(BPF_RET | BPF_A, 0);
+
+  struct sock_fprog fprog;
+  fprog.len = pc;
+  fprog.filter = prog;
+  return setsockopt(workers_[0].fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                    &fprog, sizeof(fprog)) == 0;
+#else
+  errno = ENOPROTOOPT;
+  return false;
+#endif  // SO_ATTACH_REUSEPORT_CBPF
+}
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCUDPSERVER_AVAILABLE_
@@ -0,0 +1,181 @@
+// OSCUdpServer.h defines a multi-threaded UDP receive server for Linux.
+// This is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+#ifndef OSCUDPSERVER_H_
+#define OSCUDPSERVER_H_
+
+// This uses SO_REUSEPORT and threads, so it needs Linux and <thread>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<thread>)
+#define OSCUDPSERVER_AVAILABLE_
+#endif
+#endif
+
+#ifdef OSCUDPSERVER_AVAILABLE_
+
+// C++ includes
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Project includes
+#include "OSCAllocator.h"
+#include "OSCUdpReceiver.h"
+
+namespace qindesign {
+namespace osc {
+
+// OSCUdpServer spreads received packets over several worker threads. Each
+// worker has its own socket, all bound to the same port with
+// SO_REUSEPORT, and its own OSCUdpReceiver with preallocated buffers, so
+// that nothing is shared between workers while receiving. By default the
+// kernel chooses a worker by hashing the sender's address and port.
+//
+// In affinity mode, the worker is instead chosen by hashing the first
+// containers of the OSC address, using a small classic BPF program
+// attached to the sockets, so that all messages for one address prefix
+// are handled, in order, by the same worker. Bundles all go to the same
+// worker in this mode because they all start with "#bundle".
+//
+// Handlers are called on the worker threads. Each worker's handlers can
+// be set separately, through getReceiver(), so that each can have its
+// own context.
+//
+// This is only available on Linux.
+class OSCUdpServer {
+ public:
+  // The most address characters looked at in affinity mode.
+  static constexpr int kMaxAffinityLen = 32;
+
+  // Creates a server having the given number of workers, each of which
+  // receives up to batchSize datagrams per call, each up to
+  // maxDatagramSize bytes and maxArgs message arguments. A message having
+  // more arguments is counted as invalid. If maxArgs is positive then all
+  // the memory is allocated here and the workers never use the allocator.
+  // Otherwise, the workers allocate argument room while receiving, and the
+  // allocator must be safe to use from several threads at once; the heap
+  // is, but arenas and pools aren't.
+  //
+  // Memory comes from the given allocator, or from the heap if it's
+  // nullptr. The allocator must outlive this object.
+  OSCUdpServer(int workerCount, int batchSize, int maxDatagramSize,
+               int maxArgs, OSCAllocator *allocator = nullptr);
+
+  // Not copyable
+  OSCUdpServer(const OSCUdpServer &) = delete;
+  OSCUdpServer &operator=(const OSCUdpServer &) = delete;
+
+  // Stops the workers and closes the sockets.
+  ~OSCUdpServer();
+
+  // Returns whether the workers couldn't be allocated.
+  bool isMemoryError() const {
+    return memoryErr_;
+  }
+
+  // Returns the number of workers.
+  int getWorkerCount() const {
+    return workerCount_;
+  }
+
+  // Returns a worker's receiver, for setting its handlers or reading its
+  // counters. Other than the datagram count, the counters should only be
+  // read while the server is stopped.
+  OSCUdpReceiver &getReceiver(int worker) {
+    return workers_[worker].receiver;
+  }
+
+  // Sets the message handler for all the workers.
+  void setMessageHandler(OSCUdpMessageHandler handler, void *context);
+
+  // Sets the bundle handler for all the workers.
+  void setBundleHandler(OSCUdpBundleHandler handler, void *context);
+
+  // Chooses workers by address prefix instead of by sender. The prefix is
+  // the given number of containers, for example 1 means that "/mixer/ch/1"
+  // and "/mixer/ch/2" go to the same worker, and is cut off at
+  // kMaxAffinityLen characters. Zero, the default, turns this off. This
+  // must be set before open().
+  void setAffinity(int depth) {
+    affinity_ = (depth < 0) ? 0 : depth;
+  }
+
+  // Returns the affinity depth, or zero if it's off.
+  int getAffinity() const {
+    return affinity_;
+  }
+
+  // Returns the worker that receives messages having the given address
+  // in affinity mode, or -1 if affinity is off.
+  int getWorkerForAddress(const char *address) const;
+
+  // Opens one IPv4 UDP socket per worker, all bound to the given port
+  // and, optionally, to the given local address. A port of zero picks any
+  // free port; see getPort(). This returns whether successful, and errno
+  // is set if not.
+  bool open(uint16_t port, const char *address = nullptr);
+
+  // Returns the local port the sockets are bound to, or zero if they
+  // aren't open.
+  uint16_t getPort() const;
+
+  // Starts the worker threads. This returns whether successful, and
+  // returns false if the sockets aren't open or it's already running.
+  bool start();
+
+  // Stops the worker threads and waits for them to finish. A worker
+  // notices within about kStopMillis milliseconds.
+  void stop();
+
+  // Returns whether the workers are running.
+  bool isRunning() const {
+    return running_;
+  }
+
+  // Stops the workers and closes the sockets.
+  void close();
+
+  // Returns the total number of datagrams received by all the workers.
+  // This may be called while the server is running.
+  uint64_t getDatagramCount() const;
+
+  // How long a blocked worker waits before checking whether it should
+  // stop.
+  static constexpr int kStopMillis = 50;
+
+ private:
+  struct Worker {
+    Worker(int batchSize, int maxDatagramSize, int maxArgs,
+           OSCAllocator *allocator)
+        : receiver(batchSize, maxDatagramSize, maxArgs, allocator), fd(-1) {}
+
+    OSCUdpReceiver receiver;
+    std::thread thread;
+    int fd;
+  };
+
+  // Receives on one worker's socket until told to stop.
+  void run(Worker *worker);
+
+  // Attaches the affinity program to the socket group. This returns
+  // whether successful.
+  bool attachAffinity();
+
+  OSCAllocator *allocator_;
+  bool memoryErr_;
+
+  int workerCount_;
+  Worker *workers_;
+
+  int affinity_;
+  bool running_;
+  std::atomic<bool> stopping_;
+};
+
+}  // namespace osc
+}  // namespace qindesign
+
+#endif  // OSCUDPSERVER_AVAILABLE_
+
+#endif  // OSCUDPSERVER_H_
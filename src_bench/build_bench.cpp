@@ -0,0 +1,129 @@
+// build_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares building messages having many arguments with and without
+// declaring the type tags up front. This also compares building a typical
+// small message with addXXX calls and with build(), and building nested
+// bundles by copying and in place. This runs on a host computer. To
+// build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/build_bench.cpp src/*.cpp \
+//       -o build_bench && ./build_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Project includes
+#include "LiteOSCParser.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+template <typename F>
+double timeIt(int iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kIterations = 20000;
+  ::qindesign::osc::LiteOSCParser osc{8192, 1024};
+  char tags[1026];
+
+  std::printf("%6s %14s %14s %8s\n", "args", "addXXX (ns)", "declared (ns)",
+              "speedup");
+  for (int n = 16; n <= 1024; n *= 2) {
+    tags[0] = ',';
+    std::memset(&tags[1], 'f', n);
+    tags[n + 1] = '\0';
+
+    double plainNs = timeIt(kIterations, [&]() {
+      osc.init("/frame/values");
+      for (int i = 0; i < n; i++) {
+        osc.addFloat(i);
+      }
+      sink = osc.getMessageSize();
+    });
+    double declaredNs = timeIt(kIterations, [&]() {
+      osc.init("/frame/values", tags);
+      for (int i = 0; i < n; i++) {
+        osc.addFloat(i);
+      }
+      sink = osc.getMessageSize();
+    });
+    std::printf("%6d %14.0f %14.0f %7.2fx\n", n, plainNs, declaredNs,
+                plainNs / declaredNs);
+  }
+
+  constexpr int kSmallIterations = 2000000;
+  double addNs = timeIt(kSmallIterations, [&]() {
+    osc.init("/mixer/ch/3");
+    osc.addInt(1);
+    osc.addFloat(0.5f);
+    osc.addString("name");
+    osc.addBoolean(true);
+    sink = osc.getMessageSize();
+  });
+  double buildNs = timeIt(kSmallIterations, [&]() {
+    osc.build("/mixer/ch/3", int32_t{1}, 0.5f, "name", true);
+    sink = osc.getMessageSize();
+  });
+  uint8_t buf[64];
+  double rawNs = timeIt(kSmallIterations, [&]() {
+    sink = ::qindesign::osc::LiteOSCParser::buildMessage(
+        buf, sizeof(buf), "/mixer/ch/3", int32_t{1}, 0.5f, "name", true);
+  });
+  std::printf("\nSmall message: addXXX %.1f ns, build %.1f ns, "
+              "buildMessage %.1f ns\n",
+              addNs, buildNs, rawNs);
+
+  // Three levels of bundles, each holding a few messages
+  constexpr int kBundleIterations = 200000;
+  ::qindesign::osc::OSCBundle outer;
+  ::qindesign::osc::OSCBundle middle;
+  ::qindesign::osc::OSCBundle inner;
+  double copyNs = timeIt(kBundleIterations, [&]() {
+    inner.init(3);
+    for (int i = 0; i < 4; i++) {
+      osc.build("/mixer/ch/3", int32_t{i}, 0.5f);
+      inner.addMessage(osc);
+    }
+    middle.init(2);
+    for (int i = 0; i < 4; i++) {
+      osc.build("/mixer/ch/2", int32_t{i}, 0.5f);
+      middle.addMessage(osc);
+    }
+    middle.addBundle(inner);
+    outer.init(1);
+    outer.addBundle(middle);
+    sink = outer.size();
+  });
+  double inPlaceNs = timeIt(kBundleIterations, [&]() {
+    outer.init(1);
+    outer.beginBundle(2);
+    for (int i = 0; i < 4; i++) {
+      outer.addMessage("/mixer/ch/2", int32_t{i}, 0.5f);
+    }
+    outer.beginBundle(3);
+    for (int i = 0; i < 4; i++) {
+      outer.addMessage("/mixer/ch/3", int32_t{i}, 0.5f);
+    }
+    outer.endBundle();
+    outer.endBundle();
+    sink = outer.size();
+  });
+  std::printf("Nested bundles: copying %.1f ns, in place %.1f ns\n", copyNs,
+              inPlaceNs);
+  return 0;
+}
@@ -0,0 +1,91 @@
+// bundle_read_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares reading every message in a received bundle the usual way,
+// with OSCBundle::parse, walking the sizes by hand, and copying each
+// element into a LiteOSCParser, against OSCBundleReader and an
+// OSCMessageView, which copy nothing. This runs on a host computer. To
+// build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/bundle_read_bench.cpp src/*.cpp \
+//       -o bundle_read_bench && ./bundle_read_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Project includes
+#include "LiteOSCParser.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+// Times a function, returning the time per call in nanoseconds.
+template <typename F>
+double timeIt(int iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sink = f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kIterations = 20000;
+  ::qindesign::osc::LiteOSCParser msg;
+  ::qindesign::osc::LiteOSCParser copy;
+  ::qindesign::osc::OSCMessageView view;
+  ::qindesign::osc::OSCBundleReader reader;
+
+  std::printf("%9s %14s %14s\n", "messages", "copying (ns)", "reader (ns)");
+  for (int n = 1; n <= 256; n *= 4) {
+    ::qindesign::osc::OSCBundle bundle;
+    bundle.init(1);
+    for (int i = 0; i < n; i++) {
+      msg.build("/meter/level", i, 0.5f, "label");
+      bundle.addMessage(msg);
+    }
+    const uint8_t *buf = bundle.buf();
+    int len = bundle.size();
+
+    double copyingNs = timeIt(kIterations, [&]() {
+      if (!::qindesign::osc::OSCBundle::parse(buf, len)) {
+        return 0;
+      }
+      int sum = 0;
+      for (int index = 16; index < len; ) {
+        int size = static_cast<int>(
+            uint32_t{buf[index]} << 24 | uint32_t{buf[index + 1]} << 16 |
+            uint32_t{buf[index + 2]} << 8 | uint32_t{buf[index + 3]});
+        index += 4;
+        if (copy.parse(&buf[index], size)) {
+          sum += copy.getInt(0);
+        }
+        index += size;
+      }
+      return sum;
+    });
+    double readerNs = timeIt(kIterations, [&]() {
+      if (!reader.init(buf, len)) {
+        return 0;
+      }
+      int sum = 0;
+      for (::qindesign::osc::OSCBundleElement e : reader) {
+        if (e.getMessage(&view)) {
+          sum += view.getInt(0);
+        }
+      }
+      return sum;
+    });
+
+    std::printf("%9d %14.2f %14.2f\n", n, copyingNs, readerNs);
+  }
+  return 0;
+}
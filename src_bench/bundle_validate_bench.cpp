@@ -0,0 +1,110 @@
+// bundle_validate_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares OSCBundleValidator against the recursive check that
+// OSCBundle::parse used to do, for wide bundles of messages and for
+// deeply nested bundles. This runs on a host computer. To build and run
+// from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/bundle_validate_bench.cpp \
+//       src/*.cpp -o bundle_validate_bench && ./bundle_validate_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Project includes
+#include "LiteOSCParser.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+// The previous, recursive, version of OSCBundle::parse.
+bool recursiveParse(const uint8_t *buf, int32_t len) {
+  if (len < 16 || (len & 0x03) != 0) {
+    return false;
+  }
+  if (memcmp(buf, "#bundle", 8) != 0) {
+    return false;
+  }
+  int index = 16;
+  while (index < len) {
+    int32_t size = static_cast<int32_t>(
+        uint32_t{buf[index]} << 24 | uint32_t{buf[index + 1]} << 16 |
+        uint32_t{buf[index + 2]} << 8 | uint32_t{buf[index + 3]});
+    index += 4;
+    if (size <= 0 || (size & 0x03) != 0 || index + size > len) {
+      return false;
+    }
+    if (size >= 8 && memcmp(&buf[index], "#bundle", 8) == 0) {
+      if (!recursiveParse(&buf[index], size)) {
+        return false;
+      }
+    } else if (buf[index] != '/') {
+      return false;
+    }
+    index += size;
+  }
+  return true;
+}
+
+// Times a function, returning the time per call in nanoseconds.
+template <typename F>
+double timeIt(int iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sink = f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+// Prints the times for one bundle.
+void compare(const char *name, const ::qindesign::osc::OSCBundle &bundle,
+             int iterations) {
+  ::qindesign::osc::OSCBundleValidator validator{
+      ::qindesign::osc::OSCBundleValidator::kMaxDepth};
+  double recursiveNs = timeIt(iterations, [&]() {
+    return recursiveParse(bundle.buf(), bundle.size());
+  });
+  double iterativeNs = timeIt(iterations, [&]() {
+    return validator.validate(bundle.buf(), bundle.size());
+  });
+  std::printf("%-22s %16.2f %16.2f\n", name, recursiveNs, iterativeNs);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-22s %16s %16s\n", "bundle", "recursive (ns)",
+              "iterative (ns)");
+
+  ::qindesign::osc::OSCBundle bundle;
+  for (int n = 16; n <= 1024; n *= 8) {
+    bundle.init(1);
+    for (int i = 0; i < n; i++) {
+      bundle.addMessage("/meter", i);
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%d messages", n);
+    compare(name, bundle, 200000 / n + 10);
+  }
+
+  // Nested as deeply as the builder allows, with a few messages in each
+  bundle.init(1);
+  for (int i = 0; i < ::qindesign::osc::OSCBundle::kMaxOpenBundles; i++) {
+    bundle.beginBundle(1);
+    for (int j = 0; j < 4; j++) {
+      bundle.addMessage("/meter", j);
+    }
+  }
+  while (bundle.endBundle()) {
+  }
+  compare("8 levels, 4 each", bundle, 200000);
+  return 0;
+}
@@ -0,0 +1,138 @@
+// dispatch_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares routing a message with OSCDispatcher against the usual chain
+// of fullMatch calls, for increasing numbers of handlers, and then
+// routing a pattern address with and without the pattern cache. This
+// runs on a host computer. To build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/dispatch_bench.cpp src/*.cpp \
+//       -o dispatch_bench && ./dispatch_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCDispatcher.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+void handle(const ::qindesign::osc::OSCMessageView &msg, int offset,
+            void *context) {
+  sink = offset;
+}
+
+// Times a function over all the messages, returning the time per message
+// in nanoseconds.
+template <typename F>
+double timeIt(const std::vector<::qindesign::osc::LiteOSCParser *> &msgs,
+              int rounds, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (const ::qindesign::osc::LiteOSCParser *msg : msgs) {
+      sink = f(*msg);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (rounds * msgs.size());
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kParams = 50;
+  constexpr int kMessages = 64;
+
+  std::printf("%9s %14s %16s %14s\n", "handlers", "chain (ns)",
+              "dispatcher (ns)", "compact (ns)");
+  for (int devices = 1; devices <= 64; devices *= 4) {
+    int count = devices * kParams;
+    std::vector<std::string> addresses;
+    for (int d = 0; d < devices; d++) {
+      for (int p = 0; p < kParams; p++) {
+        addresses.push_back("/device/" + std::to_string(d) + "/param/" +
+                            std::to_string(p));
+      }
+    }
+
+    ::qindesign::osc::OSCDispatcher dispatcher;
+    for (const std::string &a : addresses) {
+      dispatcher.add(a.c_str(), &handle, nullptr);
+    }
+
+    // Spread the messages evenly over the handlers
+    std::vector<::qindesign::osc::LiteOSCParser *> msgs;
+    for (int i = 0; i < kMessages; i++) {
+      auto *msg = new ::qindesign::osc::LiteOSCParser;
+      msg->init(addresses[(i * 7919) % count].c_str());
+      msgs.push_back(msg);
+    }
+
+    int rounds = 200000 / count + 10;
+    double chainNs = timeIt(msgs, rounds,
+        [&addresses](const ::qindesign::osc::LiteOSCParser &msg) {
+          for (const std::string &a : addresses) {
+            if (msg.fullMatch(0, a.c_str())) {
+              handle(msg.view(), 0, nullptr);
+              return 1;
+            }
+          }
+          return 0;
+        });
+    double dispatchNs = timeIt(msgs, 20000,
+        [&dispatcher](const ::qindesign::osc::LiteOSCParser &msg) {
+          return dispatcher.dispatch(msg);
+        });
+    dispatcher.compact();
+    double compactNs = timeIt(msgs, 20000,
+        [&dispatcher](const ::qindesign::osc::LiteOSCParser &msg) {
+          return dispatcher.dispatch(msg);
+        });
+
+    std::printf("%9d %14.2f %16.2f %14.2f\n", count, chainNs, dispatchNs,
+                compactNs);
+    for (auto *msg : msgs) {
+      delete msg;
+    }
+  }
+
+  // One pattern that fans out to a parameter on every device
+  std::printf("\n%9s %16s %14s\n", "handlers", "uncached (ns)",
+              "cached (ns)");
+  for (int devices = 1; devices <= 64; devices *= 4) {
+    ::qindesign::osc::OSCDispatcher dispatcher;
+    for (int d = 0; d < devices; d++) {
+      for (int p = 0; p < kParams; p++) {
+        std::string a = "/device/" + std::to_string(d) + "/param/" +
+                        std::to_string(p);
+        dispatcher.add(a.c_str(), &handle, nullptr);
+      }
+    }
+    dispatcher.compact();
+
+    std::vector<::qindesign::osc::LiteOSCParser *> msgs;
+    msgs.push_back(new ::qindesign::osc::LiteOSCParser);
+    msgs[0]->init("/device/*/param/7");
+
+    auto f = [&dispatcher](const ::qindesign::osc::LiteOSCParser &msg) {
+      return dispatcher.dispatch(msg);
+    };
+    double uncachedNs = timeIt(msgs, 200000 / devices, f);
+    dispatcher.setPatternCache(8, 128);
+    double cachedNs = timeIt(msgs, 200000 / devices, f);
+
+    std::printf("%9d %16.2f %14.2f\n", devices * kParams, uncachedNs,
+                cachedNs);
+    delete msgs[0];
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+// parse_args_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Measures parse time per argument for messages having many arguments,
+// both all fixed-size and mixed with strings. This also measures parsing
+// lazily and then reading only the first argument. This runs on a host
+// computer. To build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/parse_args_bench.cpp src/*.cpp \
+//       -o parse_args_bench && ./parse_args_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Project includes
+#include "LiteOSCParser.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+// Times parsing the message in 'osc' with a view. If 'lazy' is true then
+// the first argument is also read.
+double timeParse(const ::qindesign::osc::LiteOSCParser &osc, int iterations,
+                 bool lazy) {
+  ::qindesign::osc::OSCMessageView view{0};
+  view.setLazyArgs(lazy);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sink = view.parse(osc.getMessageBuf(), osc.getMessageSize());
+    if (lazy) {
+      sink = view.getFloat(0);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kIterations = 200000;
+  ::qindesign::osc::LiteOSCParser osc;
+
+  std::printf("%6s %14s %10s %14s %10s %14s\n", "args", "fixed (ns)",
+              "ns/arg", "mixed (ns)", "ns/arg", "lazy arg 0");
+  for (int n = 1; n <= 256; n *= 2) {
+    osc.init("/meter/levels");
+    for (int i = 0; i < n; i++) {
+      if ((i & 1) == 0) {
+        osc.addFloat(i);
+      } else {
+        osc.addLong(i);
+      }
+    }
+    double fixedNs = timeParse(osc, kIterations, false);
+
+    osc.init("/meter/levels");
+    for (int i = 0; i < n; i++) {
+      if ((i & 3) == 3) {
+        osc.addString("label");
+      } else {
+        osc.addFloat(i);
+      }
+    }
+    double mixedNs = timeParse(osc, kIterations, false);
+    double lazyNs = timeParse(osc, kIterations, true);
+
+    std::printf("%6d %14.2f %10.2f %14.2f %10.2f %14.2f\n", n, fixedNs,
+                fixedNs / n, mixedNs, mixedNs / n, lazyNs);
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+// parse_string_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares parsing addresses of various lengths against the original
+// byte-at-a-time string scan. This runs on a host computer. To build
+// and run from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/parse_string_bench.cpp src/*.cpp \
+//       -o parse_string_bench && ./parse_string_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Project includes
+#include "LiteOSCParser.h"
+
+namespace {
+
+// The original scan, kept here as the baseline.
+int byteParseString(const uint8_t *buf, int off, int len) {
+  while (buf[off++] != 0) {
+    if (off >= len) {
+      return -1;
+    }
+  }
+  return off;
+}
+
+// Validates an address-only message the way the original parser did. This
+// isn't inlined so that the call overhead is similar to OSCMessageView::parse.
+__attribute__((noinline)) bool byteParse(const uint8_t *buf, int len) {
+  if ((len & 0x03) != 0 || len <= 0 || buf[0] != '/') {
+    return false;
+  }
+  return byteParseString(buf, 0, len) >= 0;
+}
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+template <typename F>
+double timeIt(int iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kIterations = 2000000;
+  ::qindesign::osc::OSCMessageView view{4};
+
+  std::printf("%8s %12s %12s %8s\n", "addrLen", "byte (ns)", "new (ns)",
+              "speedup");
+  for (int addrLen = 8; addrLen <= 256; addrLen *= 2) {
+    // Address plus a NULL, padded to a multiple of 4
+    int len = ((addrLen + 1 + 3) >> 2) << 2;
+    uint8_t buf[264];
+    std::memset(buf, 0, sizeof(buf));
+    buf[0] = '/';
+    for (int i = 1; i < addrLen; i++) {
+      buf[i] = (i % 8 == 0) ? '/' : 'a' + (i % 26);
+    }
+
+    double byteNs = timeIt(kIterations, [&]() {
+      sink = byteParse(buf, len);
+    });
+    double newNs = timeIt(kIterations, [&]() {
+      sink = view.parse(buf, len);
+    });
+    std::printf("%8d %12.2f %12.2f %7.2fx\n", addrLen, byteNs, newNs,
+                byteNs / newNs);
+  }
+  return 0;
+}
@@ -0,0 +1,160 @@
+// pattern_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares matching with CompiledOSCPattern against a straightforward
+// recursive matcher that interprets the pattern string on every call.
+// The last row is a pattern that makes the recursive matcher backtrack a
+// lot. This runs on a host computer. To build and run from the project
+// root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/pattern_bench.cpp src/*.cpp \
+//       -o pattern_bench && ./pattern_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Project includes
+#include "LiteOSCParser.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+// Matches one "[...]" list at p against c. This sets *end to just past
+// the ']'.
+bool naiveList(const char *p, char c, const char **end) {
+  bool negate = (*p == '!');
+  if (negate) {
+    p++;
+  }
+  bool in = false;
+  while (*p != ']' && *p != '\0') {
+    if (p[1] == '-' && p[2] != ']' && p[2] != '\0') {
+      in = in || (p[0] <= c && c <= p[2]);
+      p += 3;
+    } else {
+      in = in || (*p == c);
+      p++;
+    }
+  }
+  *end = (*p == ']') ? p + 1 : p;
+  return in != negate;
+}
+
+// A typical recursive matcher that backtracks on '*' and '{'.
+bool naiveMatch(const char *p, const char *s) {
+  while (*p != '\0') {
+    switch (*p) {
+      case '*':
+        while (*p == '*') {
+          p++;
+        }
+        for (;; s++) {
+          if (naiveMatch(p, s)) {
+            return true;
+          }
+          if (*s == '\0' || *s == '/') {
+            return false;
+          }
+        }
+      case '?':
+        if (*s == '\0' || *s == '/') {
+          return false;
+        }
+        p++;
+        s++;
+        break;
+      case '[': {
+        if (*s == '\0' || *s == '/') {
+          return false;
+        }
+        const char *end;
+        if (!naiveList(p + 1, *s, &end)) {
+          return false;
+        }
+        p = end;
+        s++;
+        break;
+      }
+      case '{': {
+        const char *close = p;
+        while (*close != '}' && *close != '\0') {
+          close++;
+        }
+        const char *rest = (*close == '}') ? close + 1 : close;
+        const char *alt = p + 1;
+        while (alt <= close) {
+          const char *altEnd = alt;
+          while (*altEnd != ',' && altEnd != close) {
+            altEnd++;
+          }
+          int n = altEnd - alt;
+          if (strncmp(alt, s, n) == 0 && naiveMatch(rest, s + n)) {
+            return true;
+          }
+          alt = altEnd + 1;
+        }
+        return false;
+      }
+      default:
+        if (*p != *s) {
+          return false;
+        }
+        p++;
+        s++;
+    }
+  }
+  return *s == '\0';
+}
+
+// Times a matching function, returning the time per call in nanoseconds.
+template <typename F>
+double timeIt(int iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sink = f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+}  // namespace
+
+int main() {
+  struct Case {
+    const char *pattern;
+    const char *address;
+    int iterations;
+  };
+  const Case kCases[]{
+      {"/mixer/ch/3/gain", "/mixer/ch/3/gain", 1000000},
+      {"/synth/*/gain", "/synth/osc12/gain", 1000000},
+      {"/ch[0-9]/{mute,solo,gain}", "/ch7/solo", 1000000},
+      {"/a?c/*/[!x]*", "/abc/def/ghi", 1000000},
+      {"/*a*a*a*a*b", "/aaaaaaaaaaaaaaaaaaaa", 1000},
+  };
+
+  std::printf("%-28s %6s %12s %14s %8s\n", "pattern", "match",
+              "naive (ns)", "compiled (ns)", "speedup");
+  for (const Case &c : kCases) {
+    ::qindesign::osc::CompiledOSCPattern p{c.pattern};
+    double naiveNs = timeIt(c.iterations, [&c]() {
+      return naiveMatch(c.pattern, c.address);
+    });
+    double compiledNs = timeIt(c.iterations, [&p, &c]() {
+      return p.matches(c.address);
+    });
+    std::printf("%-28s %6s %12.2f %14.2f %7.1fx\n", c.pattern,
+                p.matches(c.address) ? "yes" : "no", naiveNs, compiledNs,
+                naiveNs / compiledNs);
+    if (p.matches(c.address) != naiveMatch(c.pattern, c.address)) {
+      std::printf("  mismatch!\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,201 @@
+// queue_latency_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Measures the latency of handing a message from a producer thread to a
+// consumer thread, from just before the push to just after the consumer
+// has parsed it, as percentiles. This compares OSCSpscQueue and
+// OSCMpscQueue against a mutex-protected queue of heap copies. The
+// producer paces its messages so that the queue is usually empty. The
+// results depend heavily on how many cores there are, so the cost of a
+// push and pop on a single thread is also shown. This runs on a
+// host computer. To build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -pthread -Isrc src_bench/queue_latency_bench.cpp \
+//       src/*.cpp -o queue_latency_bench && ./queue_latency_bench
+
+// C++ includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCMessageQueue.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kCount = 100000;
+constexpr int kGapNs = 2000;  // Time between messages
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+// Waits until the given time without sleeping.
+void spinUntil(int64_t t) {
+  while (nowNs() < t) {
+  }
+}
+
+// The queue of heap copies that the lock-free queues replace.
+class MutexQueue {
+ public:
+  bool push(const uint8_t *buf, int size) {
+    uint8_t *copy = new uint8_t[size];
+    std::memcpy(copy, buf, size);
+    std::lock_guard<std::mutex> lock{mutex_};
+    q_.push_back(Entry{copy, size});
+    return true;
+  }
+
+  // Copies the front message into the parser and removes it.
+  bool pop(::qindesign::osc::LiteOSCParser *osc) {
+    Entry e;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (q_.empty()) {
+        return false;
+      }
+      e = q_.front();
+      q_.pop_front();
+    }
+    bool ok = osc->parse(e.buf, e.size);
+    delete[] e.buf;
+    return ok;
+  }
+
+ private:
+  struct Entry {
+    uint8_t *buf;
+    int size;
+  };
+
+  std::mutex mutex_;
+  std::deque<Entry> q_;
+};
+
+// Prints the percentiles of the given latencies.
+void report(const char *name, std::vector<int64_t> *lat) {
+  std::sort(lat->begin(), lat->end());
+  auto pct = [lat](double p) {
+    return (*lat)[static_cast<size_t>(p * (lat->size() - 1))];
+  };
+  std::printf("%-18s %10lld %10lld %10lld %10lld\n", name,
+              static_cast<long long>(pct(0.5)),
+              static_cast<long long>(pct(0.99)),
+              static_cast<long long>(pct(0.999)),
+              static_cast<long long>(lat->back()));
+}
+
+// Times pushing and then popping one message at a time on one thread, so
+// that there's no waiting, and returns nanoseconds per message.
+template <typename Push, typename Pop>
+double timeSameThread(Push push, Pop pop) {
+  int64_t stamp;
+  auto start = Clock::now();
+  for (int i = 0; i < kCount; i++) {
+    push(i);
+    pop(&stamp);
+  }
+  auto end = Clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kCount;
+}
+
+// Runs one producer and one consumer. push(stamp) pushes a message holding
+// the time and returns whether it succeeded; pop(&stamp) gets the next
+// message's time and returns whether there was one.
+template <typename Push, typename Pop>
+void run(const char *name, Push push, Pop pop) {
+  std::vector<int64_t> lat(kCount);
+  std::thread producer{[&push]() {
+    int64_t t = nowNs();
+    for (int i = 0; i < kCount; i++) {
+      t += kGapNs;
+      spinUntil(t);
+      while (!push(nowNs())) {
+        std::this_thread::yield();
+      }
+    }
+  }};
+  for (int i = 0; i < kCount; ) {
+    int64_t stamp;
+    if (pop(&stamp)) {
+      lat[i++] = nowNs() - stamp;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  report(name, &lat);
+  std::printf("%-18s %10.1f\n", "  same thread", timeSameThread(push, pop));
+}
+
+}  // namespace
+
+int main() {
+  std::printf("cores: %u\n", std::thread::hardware_concurrency());
+  std::printf("%-18s %10s %10s %10s %10s\n", "queue (ns)", "p50", "p99",
+              "p99.9", "max");
+
+  {
+    ::qindesign::osc::OSCSpscQueue q{256, 64};
+    ::qindesign::osc::OSCMessageView view{4};
+    run("OSCSpscQueue",
+        [&q](int64_t t) { return q.pushMessage("/clock", t); },
+        [&q, &view](int64_t *t) {
+          if (!q.front(&view)) {
+            return false;
+          }
+          *t = view.getLong(0);
+          q.pop();
+          return true;
+        });
+  }
+
+  {
+    ::qindesign::osc::OSCMpscQueue q{256, 64};
+    ::qindesign::osc::OSCMessageView view{4};
+    run("OSCMpscQueue",
+        [&q](int64_t t) { return q.pushMessage("/clock", t); },
+        [&q, &view](int64_t *t) {
+          if (!q.front(&view)) {
+            return false;
+          }
+          *t = view.getLong(0);
+          q.pop();
+          return true;
+        });
+  }
+
+  {
+    MutexQueue q;
+    ::qindesign::osc::LiteOSCParser producerMsg;
+    ::qindesign::osc::LiteOSCParser consumerMsg{64, 4};
+    run("mutex + heap copy",
+        [&q, &producerMsg](int64_t t) {
+          producerMsg.build("/clock", t);
+          return q.push(producerMsg.getMessageBuf(),
+                        producerMsg.getMessageSize());
+        },
+        [&q, &consumerMsg](int64_t *t) {
+          if (!q.pop(&consumerMsg)) {
+            return false;
+          }
+          *t = consumerMsg.getLong(0);
+          return true;
+        });
+  }
+  return 0;
+}
@@ -0,0 +1,57 @@
+// scheduler_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Measures OSCScheduler's time per schedule and per due bundle with up to
+// 100k bundles pending, with a fixed capacity so that nothing is
+// allocated while timing. This runs on a host computer. To build and run
+// from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/scheduler_bench.cpp src/*.cpp \
+//       -o scheduler_bench && ./scheduler_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Project includes
+#include "OSCScheduler.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+void handle(const uint8_t * /*buf*/, int size, uint64_t /*time*/,
+            void * /*context*/) {
+  sink = size;
+}
+
+}  // namespace
+
+int main() {
+  uint8_t data[16]{};
+
+  std::printf("%9s %16s %14s\n", "pending", "schedule (ns)", "poll (ns)");
+  for (int n = 1000; n <= 100000; n *= 10) {
+    ::qindesign::osc::OSCScheduler scheduler{n, &handle, nullptr};
+
+    // Pseudo-random times
+    uint32_t x = 12345;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+      x = x * 1664525u + 1013904223u;
+      scheduler.schedule(uint64_t{x} + 2, data, sizeof(data));
+    }
+    auto mid = std::chrono::steady_clock::now();
+    sink = scheduler.poll(UINT64_MAX);
+    auto end = std::chrono::steady_clock::now();
+
+    double scheduleNs =
+        std::chrono::duration<double, std::nano>(mid - start).count() / n;
+    double pollNs =
+        std::chrono::duration<double, std::nano>(end - mid).count() / n;
+    std::printf("%9d %16.2f %14.2f\n", n, scheduleNs, pollNs);
+  }
+  return 0;
+}
@@ -0,0 +1,143 @@
+// slip_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares OSCSlipEncoder and OSCSlipDecoder, which search for special
+// bytes a vector or a word at a time, against the usual byte-at-a-time
+// SLIP loops, on a stream of typical messages. This runs on a host
+// computer. To build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/slip_bench.cpp src/*.cpp \
+//       -o slip_bench && ./slip_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCSlip.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+constexpr uint8_t kEnd = 0xc0;
+constexpr uint8_t kEsc = 0xdb;
+constexpr uint8_t kEscEnd = 0xdc;
+constexpr uint8_t kEscEsc = 0xdd;
+
+// Times the given function and returns nanoseconds per call.
+template <typename F>
+double timeIt(int iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+// Encodes a byte at a time.
+int encodeBytewise(const uint8_t *buf, int len, uint8_t *out) {
+  int n = 0;
+  out[n++] = kEnd;
+  for (int i = 0; i < len; i++) {
+    if (buf[i] == kEnd) {
+      out[n++] = kEsc;
+      out[n++] = kEscEnd;
+    } else if (buf[i] == kEsc) {
+      out[n++] = kEsc;
+      out[n++] = kEscEsc;
+    } else {
+      out[n++] = buf[i];
+    }
+  }
+  out[n++] = kEnd;
+  return n;
+}
+
+// Decodes a byte at a time and returns the number of packets.
+int decodeBytewise(const uint8_t *data, int len, uint8_t *out) {
+  int packets = 0;
+  int size = 0;
+  bool escaped = false;
+  for (int i = 0; i < len; i++) {
+    uint8_t c = data[i];
+    if (escaped) {
+      out[size++] = (c == kEscEnd) ? kEnd : kEsc;
+      escaped = false;
+    } else if (c == kEsc) {
+      escaped = true;
+    } else if (c == kEnd) {
+      if (size > 0) {
+        packets++;
+        sink = out[0];
+      }
+      size = 0;
+    } else {
+      out[size++] = c;
+    }
+  }
+  return packets;
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kMessages = 256;
+  static uint8_t stream[kMessages * 128];
+  static uint8_t out[kMessages * 128];
+
+  // A typical message, with a blob that needs a couple of escapes
+  ::qindesign::osc::LiteOSCParser msg;
+  uint8_t blob[32];
+  for (int i = 0; i < 32; i++) {
+    blob[i] = i * 7;
+  }
+  blob[5] = kEnd;
+  blob[20] = kEsc;
+  msg.build("/synth/voice/12/params", 440.0f, 0.25f, int32_t{64},
+            ::qindesign::osc::OSCBlobRef{blob, sizeof(blob)});
+  const uint8_t *buf = msg.getMessageBuf();
+  int len = msg.getMessageSize();
+
+  int streamLen = 0;
+  for (int i = 0; i < kMessages; i++) {
+    streamLen += ::qindesign::osc::OSCSlipEncoder::encode(
+        buf, len, &stream[streamLen], sizeof(stream) - streamLen);
+  }
+
+  std::printf("message size: %d bytes\n", len);
+  std::printf("%-20s %14s %14s\n", "", "bytewise (ns)", "OSCSlip (ns)");
+
+  double bytewise = timeIt(1000000, [&]() {
+    sink = encodeBytewise(buf, len, out);
+  });
+  double fast = timeIt(1000000, [&]() {
+    sink = ::qindesign::osc::OSCSlipEncoder::encode(buf, len, out,
+                                                    sizeof(out));
+  });
+  std::printf("%-20s %14.1f %14.1f\n", "encode per message", bytewise, fast);
+
+  ::qindesign::osc::OSCSlipDecoder decoder{256};
+  bytewise = timeIt(2000, [&]() {
+    sink = decodeBytewise(stream, streamLen, out);
+  }) / kMessages;
+  fast = timeIt(2000, [&]() {
+    const uint8_t *p = stream;
+    int left = streamLen;
+    while (left > 0) {
+      int n = decoder.decode(p, left);
+      p += n;
+      left -= n;
+      if (decoder.isPacketReady()) {
+        sink = decoder.getPacket()[0];
+      }
+    }
+  }) / kMessages;
+  std::printf("%-20s %14.1f %14.1f\n", "decode per message", bytewise, fast);
+  return 0;
+}
@@ -0,0 +1,132 @@
+// udp_receive_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares receiving and parsing OSC messages over loopback one datagram
+// per recvfrom call against OSCUdpReceiver, which gets a batch per
+// recvmmsg call. Bursts are queued on the socket first so that only the
+// receiving side is timed. This runs on a Linux host. To build and run
+// from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/udp_receive_bench.cpp src/*.cpp \
+//       -o udp_receive_bench && ./udp_receive_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Other includes
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCUdpReceiver.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+constexpr int kBurst = 512;
+constexpr int kBursts = 400;
+
+void handle(const ::qindesign::osc::OSCMessageView &msg,
+            const sockaddr * /*from*/, void * /*context*/) {
+  sink = msg.getInt(0);
+}
+
+// Opens a loopback socket having a large receive buffer, so that a whole
+// burst fits, and returns its port.
+int openSocket(uint16_t *port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int size = 4 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  socklen_t len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len);
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+// Sends one burst of messages to the given port.
+void sendBurst(int fd, uint16_t port, const uint8_t *buf, int len) {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < kBurst; i++) {
+    sendto(fd, buf, len, 0, reinterpret_cast<sockaddr *>(&addr),
+           sizeof(addr));
+  }
+}
+
+// Times draining kBursts bursts with the given function, which receives
+// until it has 'count' datagrams. This returns datagrams per second.
+template <typename F>
+double timeBursts(int sendFd, uint16_t port, const uint8_t *buf, int len,
+                  F receive) {
+  double seconds = 0;
+  for (int b = 0; b < kBursts; b++) {
+    sendBurst(sendFd, port, buf, len);
+    auto start = std::chrono::steady_clock::now();
+    receive(kBurst);
+    auto end = std::chrono::steady_clock::now();
+    seconds += std::chrono::duration<double>(end - start).count();
+  }
+  return kBurst * kBursts / seconds;
+}
+
+}  // namespace
+
+int main() {
+  ::qindesign::osc::LiteOSCParser msg;
+  msg.build("/mixer/ch/3/gain", int32_t{1}, 0.5f);
+  const uint8_t *buf = msg.getMessageBuf();
+  int len = msg.getMessageSize();
+  int sendFd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  std::printf("%-28s %14s\n", "receiver", "datagrams/s");
+
+  {
+    uint16_t port;
+    int fd = openSocket(&port);
+    ::qindesign::osc::LiteOSCParser osc{1536, 16};
+    uint8_t data[1536];
+    double rate = timeBursts(sendFd, port, buf, len, [&](int count) {
+      for (int i = 0; i < count; i++) {
+        ssize_t n = recvfrom(fd, data, sizeof(data), 0, nullptr, nullptr);
+        if (n > 0 && osc.parse(data, n)) {
+          sink = osc.getInt(0);
+        }
+      }
+    });
+    std::printf("%-28s %14.0f\n", "recvfrom + LiteOSCParser", rate);
+    close(fd);
+  }
+
+  for (int batch = 8; batch <= 64; batch *= 2) {
+    uint16_t port;
+    int fd = openSocket(&port);
+    ::qindesign::osc::OSCUdpReceiver receiver{batch, 1536, 16};
+    receiver.setSocket(fd);
+    receiver.setMessageHandler(&handle, nullptr);
+    double rate = timeBursts(sendFd, port, buf, len, [&](int count) {
+      while (count > 0) {
+        count -= receiver.receive(true);
+      }
+    });
+    char name[32];
+    std::snprintf(name, sizeof(name), "OSCUdpReceiver, batch %d", batch);
+    std::printf("%-28s %14.0f\n", name, rate);
+    close(fd);
+  }
+
+  close(sendFd);
+  return 0;
+}
@@ -0,0 +1,99 @@
+// udp_send_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Compares fanning one message out to many clients over loopback with one
+// sendto call per client against OSCUdpSender, which queues a reference
+// per client and sends them with sendmmsg. The clients are bound sockets
+// that are never read, so the kernel drops what doesn't fit. This runs on
+// a Linux host. To build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -Isrc src_bench/udp_send_bench.cpp src/*.cpp \
+//       -o udp_send_bench && ./udp_send_bench
+
+// C++ includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Other includes
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCUdpSender.h"
+
+namespace {
+
+constexpr int kClients = 64;
+constexpr int kUpdates = 5000;
+
+// Times kUpdates calls to the given function and returns nanoseconds per
+// datagram.
+template <typename F>
+double timeIt(F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kUpdates; i++) {
+    f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (kUpdates * kClients);
+}
+
+}  // namespace
+
+int main() {
+  // Bind the clients
+  int clients[kClients];
+  sockaddr_in addrs[kClients];
+  for (int i = 0; i < kClients; i++) {
+    clients[i] = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(clients[i], reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(clients[i], reinterpret_cast<sockaddr *>(&addr), &len);
+    addrs[i] = addr;
+  }
+
+  ::qindesign::osc::LiteOSCParser msg;
+  msg.build("/mixer/ch/3/gain", int32_t{1}, 0.5f);
+  const uint8_t *buf = msg.getMessageBuf();
+  int len = msg.getMessageSize();
+
+  std::printf("%-28s %14s\n", "sender", "ns/datagram");
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  double ns = timeIt([&]() {
+    for (int i = 0; i < kClients; i++) {
+      sendto(fd, buf, len, 0, reinterpret_cast<sockaddr *>(&addrs[i]),
+             sizeof(addrs[i]));
+    }
+  });
+  std::printf("%-28s %14.1f\n", "sendto per client", ns);
+
+  for (int slots = 8; slots <= kClients; slots *= 2) {
+    ::qindesign::osc::OSCUdpSender sender{slots, 0};
+    sender.setSocket(fd);
+    ns = timeIt([&]() {
+      for (int i = 0; i < kClients; i++) {
+        sender.queueRef(buf, len, reinterpret_cast<sockaddr *>(&addrs[i]),
+                        sizeof(addrs[i]));
+      }
+      sender.flush();
+    });
+    char name[32];
+    std::snprintf(name, sizeof(name), "OSCUdpSender, %d slots", slots);
+    std::printf("%-28s %14.1f\n", name, ns);
+  }
+
+  close(fd);
+  for (int i = 0; i < kClients; i++) {
+    close(clients[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+// udp_server_bench.cpp is part of LiteOSCParser.
+// (c) 2018-2019 Shawn Silverman
+
+// Measures how many datagrams per second OSCUdpServer receives and parses
+// over loopback as the number of workers grows. One thread sends from
+// several sockets for a fixed time, so that the kernel spreads the
+// traffic over the workers by sender port. Both sides share the machine,
+// so the results depend on how many cores there are. This runs on a
+// Linux host. To build and run from the project root:
+//
+//   g++ -O2 -std=c++11 -pthread -Isrc src_bench/udp_server_bench.cpp \
+//       src/*.cpp -o udp_server_bench && ./udp_server_bench
+
+// C++ includes
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+// Other includes
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Project includes
+#include "LiteOSCParser.h"
+#include "OSCUdpSender.h"
+#include "OSCUdpServer.h"
+
+namespace {
+
+// Prevents the compiler from optimizing away the results.
+volatile int sink;
+
+constexpr int kSenders = 8;
+constexpr int kMillis = 1000;
+
+void handle(const ::qindesign::osc::OSCMessageView &msg,
+            const sockaddr * /*from*/, void * /*context*/) {
+  sink = msg.getInt(0);
+}
+
+// Sends the message from kSenders sockets until told to stop.
+void sendUntil(uint16_t port, const std::atomic<bool> *stop) {
+  sockaddr_in to{};
+  to.sin_family = AF_INET;
+  to.sin_port = htons(port);
+  to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  ::qindesign::osc::LiteOSCParser msg;
+  msg.build("/mixer/ch/3/gain", int32_t{1}, 0.5f);
+
+  ::qindesign::osc::OSCUdpSender *senders[kSenders];
+  for (int i = 0; i < kSenders; i++) {
+    senders[i] = new ::qindesign::osc::OSCUdpSender{32, 0};
+    senders[i]->open();
+  }
+  while (!stop->load(std::memory_order_relaxed)) {
+    for (int i = 0; i < kSenders; i++) {
+      for (int j = 0; j < 32; j++) {
+        senders[i]->queueRef(msg.getMessageBuf(), msg.getMessageSize(),
+                             reinterpret_cast<sockaddr *>(&to), sizeof(to));
+      }
+    }
+  }
+  for (int i = 0; i < kSenders; i++) {
+    delete senders[i];
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::printf("cores: %u\n", std::thread::hardware_concurrency());
+  std::printf("%8s %16s\n", "workers", "datagrams/s");
+  for (int workers = 1; workers <= 8; workers *= 2) {
+    ::qindesign::osc::OSCUdpServer server{workers, 32, 1536, 16};
+    server.setMessageHandler(&handle, nullptr);
+    if (!server.open(0, "127.0.0.1") || !server.start()) {
+      std::printf("couldn't start the server\n");
+      return 1;
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread sender{&sendUntil, server.getPort(), &stop};
+    std::this_thread::sleep_for(std::chrono::milliseconds(kMillis));
+    stop = true;
+    sender.join();
+    server.stop();
+
+    std::printf("%8d %16.0f\n", workers,
+                server.getDatagramCount() * 1000.0 / kMillis);
+  }
+  return 0;
+}
@@ -8,16 +8,35 @@
 #else
 #include <stdint.h>
 #endif
+#if __has_include(<type_traits>)
+#include <type_traits>
+#endif
 #else
 #include <cstdint>
 #endif
+#if defined(__linux__)
+#include <thread>
+#endif
 
 // Other includes
 #include <Arduino.h>
 #include <ArduinoUnit.h>
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#endif
 
 // Project includes
 #include "LiteOSCParser.h"
+#include "OSCBundlePacker.h"
+#include "OSCDispatcher.h"
+#include "OSCMessageQueue.h"
+#include "OSCScheduler.h"
+#include "OSCSlip.h"
+#include "OSCUdpReceiver.h"
+#include "OSCUdpSender.h"
+#include "OSCUdpServer.h"
 
 ::qindesign::osc::LiteOSCParser osc{64, 4};
 
@@ -59,11 +78,26 @@ void __attribute__((naked)) hard_fault_isr() {
 // The tests
 #include "tests/add_args.inc"
 #include "tests/address.inc"
+#include "tests/allocator.inc"
 #include "tests/args.inc"
+#include "tests/build.inc"
 #include "tests/bundle.inc"
+#include "tests/bundle_packer.inc"
+#include "tests/bundle_reader.inc"
+#include "tests/bundle_validator.inc"
+#include "tests/dispatcher.inc"
+#include "tests/lazy.inc"
 #include "tests/match.inc"
 #include "tests/memory.inc"
+#include "tests/move.inc"
 #include "tests/packet.inc"
+#include "tests/pattern.inc"
+#include "tests/queue.inc"
+#include "tests/scheduler.inc"
+#include "tests/set_args.inc"
+#include "tests/slip.inc"
+#include "tests/udp.inc"
+#include "tests/view.inc"
 
 void setup() {
   Serial.begin(115200);